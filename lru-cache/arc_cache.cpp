@@ -0,0 +1,101 @@
+#include "arc_cache.h"
+
+#include <algorithm>
+
+ArcCache::ArcCache(size_t max_size) : max_size_(max_size) {}
+
+void ArcCache::set(std::string_view key, std::string_view value) {
+    if (max_size_ == 0) {
+        return;
+    }
+    if (auto it = data_.find(key); it != data_.end()) {
+        const Entry *entry = &*it;
+        switch (entry->list) {
+            case List::kT1:
+            case List::kT2:
+                break;
+            case List::kB1:
+                // A recently evicted key came back: T1 should have been larger.
+                p_ = std::min(max_size_, p_ + std::max<size_t>(b2_.size() / b1_.size(), 1));
+                replace(false);
+                break;
+            case List::kB2:
+                p_ -= std::min(p_, std::max<size_t>(b1_.size() / b2_.size(), 1));
+                replace(true);
+                break;
+        }
+        entry->value = value;
+        move(entry, List::kT2);
+        return;
+    }
+
+    if (t1_.size() + b1_.size() == max_size_) {
+        if (t1_.size() < max_size_) {
+            erase(b1_.front());
+            replace(false);
+        } else {
+            // B1 is empty and T1 takes the whole cache: drop its LRU entry
+            // without remembering it.
+            erase(t1_.front());
+        }
+    } else if (size() + b1_.size() + b2_.size() >= max_size_) {
+        if (size() + b1_.size() + b2_.size() == 2 * max_size_) {
+            erase(b2_.front());
+        }
+        replace(false);
+    }
+    const Entry *entry = &*data_.emplace(key, value).first;
+    t1_.push_back(entry);
+}
+
+bool ArcCache::get(std::string_view key, std::string *value) {
+    auto it = data_.find(key);
+    if (it == data_.end() || it->list == List::kB1 || it->list == List::kB2) {
+        return false;
+    }
+    *value = it->value;
+    move(&*it, List::kT2);
+    return true;
+}
+
+void ArcCache::replace(bool in_b2) {
+    if (size() < max_size_) {
+        return;
+    }
+    if (!t1_.empty() && (t1_.size() > p_ || (in_b2 && t1_.size() == p_))) {
+        move(t1_.front(), List::kB1);
+    } else if (!t2_.empty()) {
+        move(t2_.front(), List::kB2);
+    } else {
+        move(t1_.front(), List::kB1);
+    }
+}
+
+void ArcCache::move(const Entry *entry, List to) {
+    list_of(entry->list).remove(entry);
+    entry->list = to;
+    if (to == List::kB1 || to == List::kB2) {
+        // Ghosts only keep their key.
+        std::string().swap(entry->value);
+    }
+    list_of(to).push_back(entry);
+}
+
+void ArcCache::erase(const Entry *entry) {
+    list_of(entry->list).remove(entry);
+    data_.erase(data_.find(std::string_view(entry->key)));
+}
+
+RecencyList<ArcCache::Entry> &ArcCache::list_of(List list) {
+    switch (list) {
+        case List::kT1:
+            return t1_;
+        case List::kT2:
+            return t2_;
+        case List::kB1:
+            return b1_;
+        case List::kB2:
+            break;
+    }
+    return b2_;
+}
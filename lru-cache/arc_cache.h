@@ -0,0 +1,71 @@
+#ifndef ARC_CACHE_H
+
+#define ARC_CACHE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "recency_list.h"
+#include "string_key.h"
+
+// Adaptive Replacement Cache (Megiddo and Modha) with the set()/get() contract
+// of LruCache. Resident entries are split between a recency list T1 (seen
+// once) and a frequency list T2 (seen again while cached). Evicted keys are
+// remembered without their values in ghost lists B1 and B2 of up to max_size
+// keys in total. A set() of a key found in B1 means T1 was too small and grows
+// its target size p; one found in B2 shrinks it. The split between recency
+// and frequency thus follows the workload instead of being fixed.
+class ArcCache {
+public:
+    explicit ArcCache(size_t max_size);
+
+    ArcCache(const ArcCache &) = delete;
+    ~ArcCache() = default;
+    ArcCache(ArcCache &&) = delete;
+    ArcCache &operator=(const ArcCache &) = delete;
+    ArcCache &operator=(const ArcCache &&) = delete;
+
+    void set(std::string_view key, std::string_view value);
+
+    bool get(std::string_view key, std::string *value);
+
+    // Resident entries; ghosts are not counted.
+    [[nodiscard]] size_t size() const { return t1_.size() + t2_.size(); }
+
+    // Current target size of T1.
+    [[nodiscard]] size_t recency_target() const { return p_; }
+
+private:
+    enum class List : uint8_t { kT1, kT2, kB1, kB2 };
+
+    struct Entry {
+        Entry(std::string_view key, std::string_view value) : key(key), value(value) {}
+
+        std::string key;
+        // Empty for ghosts.
+        mutable std::string value;
+        mutable List list{List::kT1};
+        mutable const Entry *prev{nullptr};
+        mutable const Entry *next{nullptr};
+    };
+
+    // Makes room in T1 + T2 by demoting the LRU entry of T1 or T2 to its
+    // ghost list, per the target p. in_b2 is set when the key being
+    // inserted was found in B2.
+    void replace(bool in_b2);
+    void move(const Entry *entry, List to);
+    void erase(const Entry *entry);
+
+    RecencyList<Entry> &list_of(List list);
+
+    std::unordered_set<Entry, StringKeyHash, StringKeyEqual> data_;
+    RecencyList<Entry> t1_;
+    RecencyList<Entry> t2_;
+    RecencyList<Entry> b1_;
+    RecencyList<Entry> b2_;
+    size_t p_{0};
+    size_t max_size_;
+};
+#endif
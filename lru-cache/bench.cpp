@@ -0,0 +1,1003 @@
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cache_stats.h"
+#include "arc_cache.h"
+#include "clock_cache.h"
+#include "concurrent_lru_cache.h"
+#include "flat_index.h"
+#include "lru_cache.h"
+#include "sharded_lru_cache.h"
+#include "slab_lru_cache.h"
+#include "tiny_lfu_cache.h"
+#include "trace.h"
+
+// Standalone benchmarks for the lru-cache task.
+// Usage: lru_cache_bench [name...]; without arguments every benchmark runs.
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+}  // namespace
+
+// Counts every heap allocation made through operator new, so benchmarks can
+// report allocations per operation.
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// The array forms are replaced too, so that every new and delete of the
+// program goes through the same malloc()/free() pair. GCC cannot tell that the
+// replaced operator new is malloc() underneath and, once a delete is inlined,
+// warns about free() on its result; the pair matches, so that is silenced.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+#pragma GCC diagnostic pop
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double MeasureSeconds(F &&f) {
+    const auto start = Clock::now();
+    f();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::vector<std::string> MakeKeys(size_t count) {
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back("key:" + std::to_string(i));
+    }
+    return keys;
+}
+
+// LruCache behind one global mutex, i.e. what callers had to do before
+// ShardedLruCache existed.
+class GlobalLockLruCache {
+public:
+    explicit GlobalLockLruCache(size_t max_size) : cache_(max_size) {}
+
+    void set(const std::string &key, const std::string &value) {
+        const std::lock_guard lock(mutex_);
+        cache_.set(key, value);
+    }
+
+    bool get(const std::string &key, std::string *value) {
+        const std::lock_guard lock(mutex_);
+        return cache_.get(key, value);
+    }
+
+private:
+    std::mutex mutex_;
+    LruCache cache_;
+};
+
+// The layout LruCache had before entries became intrusive nodes: a std::list
+// of key/value pairs plus an unordered_map holding a second copy of the key.
+class ListMapLruCache {
+public:
+    explicit ListMapLruCache(size_t max_size) : max_size_(max_size) {}
+
+    void set(const std::string &key, const std::string &value) {
+        if (auto it = data_.find(key); it != data_.end()) {
+            it->second->second = value;
+            lru_.splice(lru_.end(), lru_, it->second);
+            return;
+        }
+        if (data_.size() >= max_size_) {
+            data_.erase(lru_.front().first);
+            lru_.pop_front();
+        }
+        lru_.emplace_back(key, value);
+        data_.emplace(key, std::prev(lru_.end()));
+    }
+
+private:
+    std::list<std::pair<std::string, std::string>> lru_;
+    std::unordered_map<std::string, std::list<std::pair<std::string, std::string>>::iterator>
+        data_;
+    size_t max_size_;
+};
+
+// Heap bytes in use according to glibc, including allocator overhead.
+size_t HeapInUse() {
+    const auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+// 90% get / 10% set (or `set_percent`) over a key space twice the cache size.
+template <typename Cache>
+double RunMixedWorkload(Cache &cache, const std::vector<std::string> &keys, size_t threads,
+                        size_t ops_per_thread, size_t set_percent = 10) {
+    std::vector<std::thread> workers;
+    const double seconds = MeasureSeconds([&] {
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937_64 gen(t + 1);
+                std::string value;
+                for (size_t i = 0; i < ops_per_thread; ++i) {
+                    const auto r = gen();
+                    const auto &key = keys[r % keys.size()];
+                    if ((r >> 32) % 100 < set_percent) {
+                        cache.set(key, key);
+                    } else {
+                        cache.get(key, &value);
+                    }
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    });
+    return static_cast<double>(threads * ops_per_thread) / seconds / 1e6;
+}
+
+void BenchShardedThroughput() {
+    constexpr size_t kCapacity = 50'000;
+    constexpr size_t kOpsPerThread = 500'000;
+    const auto keys = MakeKeys(2 * kCapacity);
+
+    std::vector<size_t> thread_counts = {1, 2, 4, 8};
+    if (const size_t hw = std::thread::hardware_concurrency(); hw > 8) {
+        thread_counts.push_back(hw);
+    }
+
+    std::printf("%8s %18s %18s\n", "threads", "global lock Mop/s", "sharded Mop/s");
+    for (auto threads : thread_counts) {
+        GlobalLockLruCache global(kCapacity);
+        ShardedLruCache sharded(kCapacity);
+        const double global_mops = RunMixedWorkload(global, keys, threads, kOpsPerThread);
+        const double sharded_mops = RunMixedWorkload(sharded, keys, threads, kOpsPerThread);
+        std::printf("%8zu %18.2f %18.2f\n", threads, global_mops, sharded_mops);
+    }
+}
+
+template <typename Cache>
+void ReportMemoryPerEntry(const char *layout, const std::vector<std::string> &keys,
+                          const std::string &value) {
+    const size_t heap_before = HeapInUse();
+    const size_t allocations_before = g_allocations.load();
+    {
+        Cache cache(keys.size());
+        for (const auto &key : keys) {
+            cache.set(key, value);
+        }
+        const auto entries = static_cast<double>(keys.size());
+        std::printf("%12s %10zu %10zu %14.1f %14.2f\n", layout, keys.front().size(), value.size(),
+                    static_cast<double>(HeapInUse() - heap_before) / entries,
+                    static_cast<double>(g_allocations.load() - allocations_before) / entries);
+    }
+}
+
+void BenchMemoryPerEntry() {
+    constexpr size_t kEntries = 1'000'000;
+
+    std::printf("%12s %10s %10s %14s %14s\n", "layout", "key bytes", "val bytes", "heap B/entry",
+                "allocs/entry");
+    // Short keys fit in the SSO buffer; long ones make every key copy allocate.
+    for (const std::string prefix : {"", "a-rather-long-key-prefix:"}) {
+        std::vector<std::string> keys;
+        keys.reserve(kEntries);
+        for (size_t i = 0; i < kEntries; ++i) {
+            auto key = prefix + std::to_string(i);
+            key.resize(prefix.size() + 8, '.');
+            keys.push_back(std::move(key));
+        }
+        const std::string value(16, 'v');
+        ReportMemoryPerEntry<ListMapLruCache>("list+map", keys, value);
+        ReportMemoryPerEntry<LruCache>("LruCache", keys, value);
+    }
+}
+
+// Average nanoseconds per hit of get() with the given output type.
+template <typename Out>
+double MeasureHitNanos(LruCache &cache, const std::vector<std::string> &keys, size_t hits) {
+    Out value;
+    size_t checksum = 0;
+    const double seconds = MeasureSeconds([&] {
+        for (size_t i = 0; i < hits; ++i) {
+            cache.get(keys[i % keys.size()], &value);
+            checksum += value.size();
+        }
+    });
+    if (checksum == 0) {
+        std::printf("unexpected misses\n");
+    }
+    return seconds * 1e9 / static_cast<double>(hits);
+}
+
+void BenchHitLatency() {
+    constexpr size_t kEntries = 1024;
+    constexpr size_t kHits = 2'000'000;
+    const auto keys = MakeKeys(kEntries);
+
+    std::printf("%10s %14s %14s\n", "value", "copy ns/hit", "view ns/hit");
+    for (size_t value_size : {size_t{64}, size_t{4} << 10, size_t{64} << 10}) {
+        LruCache cache(kEntries);
+        for (const auto &key : keys) {
+            cache.set(key, std::string(value_size, 'v'));
+        }
+        const double copy_ns = MeasureHitNanos<std::string>(cache, keys, kHits);
+        const double view_ns = MeasureHitNanos<std::string_view>(cache, keys, kHits);
+        std::printf("%10zu %14.1f %14.1f\n", value_size, copy_ns, view_ns);
+    }
+}
+
+// Zipf-distributed key ids; with scans enabled, every `scan_every` accesses a
+// one-pass scan of `scan_length` never repeated keys is interleaved.
+std::vector<std::string> MakeZipfTrace(size_t accesses, size_t universe, size_t scan_every,
+                                       size_t scan_length) {
+    ZipfGenerator zipf(universe, 0.99, 42);
+    std::vector<std::string> trace;
+    trace.reserve(accesses);
+    size_t scanned = 0;
+    while (trace.size() < accesses) {
+        if (scan_every != 0 && !trace.empty() && trace.size() % scan_every == 0) {
+            for (size_t i = 0; i < scan_length && trace.size() < accesses; ++i) {
+                trace.push_back("scan:" + std::to_string(scanned++));
+            }
+        }
+        trace.push_back("key:" + std::to_string(zipf()));
+    }
+    return trace;
+}
+
+// Read-through replay: every miss is followed by a set of the key.
+template <typename Cache>
+double ReplayHitRatio(size_t capacity, const std::vector<std::string> &trace) {
+    Cache cache(capacity);
+    std::string value;
+    size_t hits = 0;
+    for (const auto &key : trace) {
+        if (cache.get(key, &value)) {
+            ++hits;
+        } else {
+            cache.set(key, key);
+        }
+    }
+    return 100.0 * static_cast<double>(hits) / static_cast<double>(trace.size());
+}
+
+void BenchHitRatio() {
+    constexpr size_t kAccesses = 2'000'000;
+    constexpr size_t kUniverse = 200'000;
+    const auto zipf_trace = MakeZipfTrace(kAccesses, kUniverse, 0, 0);
+    const auto scan_trace = MakeZipfTrace(kAccesses, kUniverse, 100'000, 50'000);
+
+    std::printf("%10s %10s %10s %12s\n", "trace", "capacity", "LRU hit%", "TinyLFU hit%");
+    for (size_t capacity : {size_t{1'000}, size_t{10'000}, size_t{50'000}}) {
+        for (const auto &[name, trace] : {std::pair{"zipf", &zipf_trace}, {"zipf+scan", &scan_trace}}) {
+            std::printf("%10s %10zu %10.2f %12.2f\n", name, capacity,
+                        ReplayHitRatio<LruCache>(capacity, *trace),
+                        ReplayHitRatio<TinyLfuCache>(capacity, *trace));
+        }
+    }
+}
+
+// A workload that keeps changing character: phases where recently used keys
+// come back (a working set sliding over the key space) alternate with phases
+// where popular keys come back (Zipf with one-pass scans).
+std::vector<std::string> MakeShiftingTrace(size_t phases, size_t phase_length) {
+    ZipfGenerator zipf(200'000, 0.99, 42);
+    std::mt19937_64 gen(7);
+    std::vector<std::string> trace;
+    trace.reserve(phases * phase_length);
+    size_t window = 0;
+    size_t scanned = 0;
+    for (size_t phase = 0; phase < phases; ++phase) {
+        for (size_t i = 0; i < phase_length; ++i) {
+            if (phase % 2 == 0) {
+                // Working set of 5000 keys, moving one key every 4 accesses.
+                trace.push_back("recent:" + std::to_string(window++ / 4 + gen() % 5'000));
+            } else if (i % 50'000 < 10'000) {
+                trace.push_back("scan:" + std::to_string(scanned++));
+            } else {
+                trace.push_back("key:" + std::to_string(zipf()));
+            }
+        }
+    }
+    return trace;
+}
+
+// Replays LRU_BENCH_TRACE (a text file with one key per line) if set, and a
+// synthetic trace that shifts between recency and frequency phases otherwise.
+void BenchArc() {
+    std::vector<std::string> trace;
+    const char *path = std::getenv("LRU_BENCH_TRACE");
+    if (path != nullptr) {
+        trace = ReadTextTrace(path);
+        if (trace.empty()) {
+            std::printf("cannot read trace %s\n", path);
+            return;
+        }
+    } else {
+        trace = MakeShiftingTrace(8, 250'000);
+    }
+
+    std::printf("%zu accesses from %s\n%10s %10s %10s\n", trace.size(),
+                path != nullptr ? path : "the shifting synthetic trace", "capacity", "LRU hit%",
+                "ARC hit%");
+    for (size_t capacity : {size_t{1'000}, size_t{10'000}, size_t{50'000}}) {
+        std::printf("%10zu %10.2f %10.2f\n", capacity, ReplayHitRatio<LruCache>(capacity, trace),
+                    ReplayHitRatio<ArcCache>(capacity, trace));
+    }
+}
+
+struct Record {
+    uint64_t id;
+    double score;
+    uint32_t flags[4];
+};
+
+// What an integer-keyed, struct-valued cache had to do with the string-only
+// LruCache: format the key and memcpy the value in and out of a std::string.
+double MeasureSerializedNanos(const std::vector<uint64_t> &ids, size_t capacity) {
+    LruCache cache(capacity);
+    std::string buffer;
+    Record record{};
+    uint64_t checksum = 0;
+    const double seconds = MeasureSeconds([&] {
+        for (auto id : ids) {
+            const auto key = std::to_string(id);
+            if (cache.get(key, &buffer)) {
+                std::memcpy(&record, buffer.data(), sizeof(record));
+                checksum += record.id;
+            } else {
+                record = Record{id, 1.0, {}};
+                cache.set(key, std::string_view(reinterpret_cast<const char *>(&record), sizeof(record)));
+            }
+        }
+    });
+    if (checksum == 1) {
+        std::printf("unreachable\n");
+    }
+    return seconds * 1e9 / static_cast<double>(ids.size());
+}
+
+double MeasureTypedNanos(const std::vector<uint64_t> &ids, size_t capacity) {
+    BasicLruCache<uint64_t, Record> cache(capacity);
+    Record record{};
+    uint64_t checksum = 0;
+    const double seconds = MeasureSeconds([&] {
+        for (auto id : ids) {
+            if (cache.get(id, &record)) {
+                checksum += record.id;
+            } else {
+                cache.set(id, Record{id, 1.0, {}});
+            }
+        }
+    });
+    if (checksum == 1) {
+        std::printf("unreachable\n");
+    }
+    return seconds * 1e9 / static_cast<double>(ids.size());
+}
+
+void BenchTypedKeys() {
+    constexpr size_t kOps = 2'000'000;
+    constexpr size_t kUniverse = 200'000;
+
+    ZipfGenerator zipf(kUniverse, 0.99, 7);
+    std::vector<uint64_t> ids(kOps);
+    for (auto &id : ids) {
+        id = zipf() * 0x9E3779B97F4A7C15ULL;
+    }
+
+    std::printf("%10s %18s %18s\n", "capacity", "serialized ns/op", "typed ns/op");
+    for (size_t capacity : {size_t{1'000}, size_t{100'000}}) {
+        std::printf("%10zu %18.1f %18.1f\n", capacity, MeasureSerializedNanos(ids, capacity),
+                    MeasureTypedNanos(ids, capacity));
+    }
+}
+
+// FlatIndex on its own, without the recency relink a cache hit also does.
+class FlatIndexOnly {
+public:
+    explicit FlatIndexOnly(size_t max_size) { nodes_.reserve(max_size); }
+
+    void set(uint64_t key, uint64_t value) {
+        nodes_.push_back(Node{std::hash<uint64_t>{}(key), key, value});
+        index_.insert(&nodes_.back());
+    }
+
+    bool get(uint64_t key, uint64_t *value) {
+        const Node *node = index_.find(std::hash<uint64_t>{}(key),
+                                       [key](const Node &node) { return node.key == key; });
+        if (node == nullptr) {
+            return false;
+        }
+        *value = node->value;
+        return true;
+    }
+
+private:
+    struct Node {
+        size_t hash;
+        uint64_t key;
+        uint64_t value;
+    };
+
+    std::vector<Node> nodes_;
+    FlatIndex<Node> index_;
+};
+
+// Node-based reference: bucket, then node.
+class NodeMapIndex {
+public:
+    explicit NodeMapIndex(size_t /*max_size*/) {}
+
+    void set(uint64_t key, uint64_t value) { data_[key] = value; }
+
+    bool get(uint64_t key, uint64_t *value) {
+        auto it = data_.find(key);
+        if (it == data_.end()) {
+            return false;
+        }
+        *value = it->second;
+        return true;
+    }
+
+private:
+    std::unordered_map<uint64_t, uint64_t> data_;
+};
+
+// Random-order hits on a cache holding `entries` random 64-bit keys, in
+// nanoseconds per lookup.
+template <typename Cache>
+double MeasureLookupNanos(size_t entries, size_t lookups) {
+    std::mt19937_64 gen(entries);
+    std::vector<uint64_t> keys(entries);
+    for (auto &key : keys) {
+        key = gen();
+    }
+    Cache cache(entries);
+    for (auto key : keys) {
+        cache.set(key, key);
+    }
+    std::vector<uint64_t> probes(lookups);
+    for (auto &probe : probes) {
+        probe = keys[gen() % entries];
+    }
+    uint64_t value = 0;
+    uint64_t checksum = 0;
+    const double seconds = MeasureSeconds([&] {
+        for (auto probe : probes) {
+            cache.get(probe, &value);
+            checksum += value;
+        }
+    });
+    if (checksum == 1) {
+        std::printf("unreachable\n");
+    }
+    return seconds * 1e9 / static_cast<double>(lookups);
+}
+
+// Set LRU_BENCH_MAX_ENTRIES to skip the largest sizes on small machines; 50M
+// entries need about 4 GiB.
+void BenchLookupLatency() {
+    constexpr size_t kLookups = 2'000'000;
+    size_t max_entries = 50'000'000;
+    if (const char *limit = std::getenv("LRU_BENCH_MAX_ENTRIES")) {
+        max_entries = std::strtoull(limit, nullptr, 10);
+    }
+
+    std::printf("%12s %18s %18s %18s\n", "entries", "LruCache ns/get", "FlatIndex ns/find",
+                "unordered_map ns");
+    for (size_t entries : {size_t{1'000}, size_t{1'000'000}, size_t{50'000'000}}) {
+        if (entries > max_entries) {
+            std::printf("%12zu %18s\n", entries, "skipped");
+            continue;
+        }
+        const double cache_ns = MeasureLookupNanos<BasicLruCache<uint64_t, uint64_t>>(entries, kLookups);
+        const double index_ns = MeasureLookupNanos<FlatIndexOnly>(entries, kLookups);
+        const double map_ns = MeasureLookupNanos<NodeMapIndex>(entries, kLookups);
+        std::printf("%12zu %18.1f %18.1f %18.1f\n", entries, cache_ns, index_ns, map_ns);
+    }
+}
+
+struct WorkloadResult {
+    double hit_ratio;
+    double mops;
+};
+
+// The "Stress 2" workload of test.cpp: keys drawn from 500, a cache of 100,
+// half sets and half gets.
+template <typename Cache>
+WorkloadResult RunStress2(size_t ops) {
+    Cache cache(100);
+    std::mt19937 gen(431'234);
+    std::vector<std::pair<std::string, bool>> trace;
+    trace.reserve(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        auto key = std::to_string(gen() % 500);
+        trace.emplace_back(std::move(key), gen() % 2 != 0);
+    }
+    std::string value;
+    size_t gets = 0;
+    size_t hits = 0;
+    const double seconds = MeasureSeconds([&] {
+        for (const auto &[key, is_set] : trace) {
+            if (is_set) {
+                cache.set(key, "foo");
+            } else {
+                ++gets;
+                hits += cache.get(key, &value) ? 1 : 0;
+            }
+        }
+    });
+    return {100.0 * static_cast<double>(hits) / static_cast<double>(gets),
+            static_cast<double>(ops) / seconds / 1e6};
+}
+
+// The "Stress 3" workload of test.cpp: fill, read everything back in another
+// order, then insert as many new keys while probing the old ones.
+template <typename Cache>
+WorkloadResult RunStress3(size_t size) {
+    std::mt19937 gen(31'134);
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 2 * size; ++i) {
+        keys.push_back(std::to_string(i));
+    }
+    std::vector<size_t> order(size);
+    for (size_t i = 0; i < size; ++i) {
+        order[i] = i;
+    }
+    std::ranges::shuffle(order, gen);
+
+    Cache cache(size);
+    std::string value;
+    size_t hits = 0;
+    const double seconds = MeasureSeconds([&] {
+        for (auto i : order) {
+            cache.set(keys[i], "foo");
+        }
+        for (auto i : order) {
+            hits += cache.get(keys[i], &value) ? 1 : 0;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            cache.set(keys[size + i], "foo");
+            hits += cache.get(keys[order[i]], &value) ? 1 : 0;
+        }
+    });
+    return {100.0 * static_cast<double>(hits) / static_cast<double>(2 * size),
+            static_cast<double>(4 * size) / seconds / 1e6};
+}
+
+void PrintWorkload(const char *workload, const char *engine, WorkloadResult result) {
+    std::printf("%20s %10s %10.2f %10.2f\n", workload, engine, result.hit_ratio, result.mops);
+}
+
+// ClockCache reads under the shared side of a reader-writer lock.
+class SharedLockClockCache {
+public:
+    explicit SharedLockClockCache(size_t max_size) : cache_(max_size) {}
+
+    void set(const std::string &key, const std::string &value) {
+        const std::unique_lock lock(mutex_);
+        cache_.set(key, value);
+    }
+
+    bool get(const std::string &key, std::string *value) {
+        const std::shared_lock lock(mutex_);
+        return cache_.get(key, value);
+    }
+
+private:
+    std::shared_mutex mutex_;
+    ClockCache cache_;
+};
+
+void BenchClock() {
+    std::printf("%20s %10s %10s %10s\n", "workload", "engine", "hit%", "Mop/s");
+    PrintWorkload("stress 2", "LRU", RunStress2<LruCache>(2'000'000));
+    PrintWorkload("stress 2", "CLOCK", RunStress2<ClockCache>(2'000'000));
+    PrintWorkload("stress 3", "LRU", RunStress3<LruCache>(100'000));
+    PrintWorkload("stress 3", "CLOCK", RunStress3<ClockCache>(100'000));
+
+    const auto trace = MakeZipfTrace(1'000'000, 200'000, 0, 0);
+    std::printf("%20s %10s %10.2f\n", "zipf read-through", "LRU",
+                ReplayHitRatio<LruCache>(10'000, trace));
+    std::printf("%20s %10s %10.2f\n", "zipf read-through", "CLOCK",
+                ReplayHitRatio<ClockCache>(10'000, trace));
+
+    constexpr size_t kCapacity = 50'000;
+    constexpr size_t kOpsPerThread = 500'000;
+    const auto keys = MakeKeys(2 * kCapacity);
+    std::printf("\n%8s %18s %18s\n", "threads", "LRU+mutex Mop/s", "CLOCK+rwlock Mop/s");
+    for (size_t threads : {1, 2, 4, 8}) {
+        GlobalLockLruCache lru(kCapacity);
+        SharedLockClockCache clock(kCapacity);
+        const double lru_mops = RunMixedWorkload(lru, keys, threads, kOpsPerThread);
+        const double clock_mops = RunMixedWorkload(clock, keys, threads, kOpsPerThread);
+        std::printf("%8zu %18.2f %18.2f\n", threads, lru_mops, clock_mops);
+    }
+}
+
+// Random-order hits on the probed uint64 keys, issued as get() calls one key at
+// a time (batch == 1) or as get_many() calls of `batch` keys, in nanoseconds
+// per key.
+template <typename Cache>
+double MeasureBatchNanos(Cache &cache, const std::vector<uint64_t> &probes, size_t batch) {
+    std::vector<uint64_t> values(batch);
+    auto found = std::make_unique<bool[]>(batch);
+    uint64_t checksum = 0;
+    const double seconds = MeasureSeconds([&] {
+        if (batch == 1) {
+            for (auto probe : probes) {
+                cache.get(probe, &values[0]);
+                checksum += values[0];
+            }
+            return;
+        }
+        for (size_t begin = 0; begin + batch <= probes.size(); begin += batch) {
+            const std::span<const uint64_t> keys(&probes[begin], batch);
+            checksum += cache.get_many(keys, values.data(), found.get());
+            checksum += values[0];
+        }
+    });
+    if (checksum == 1) {
+        std::printf("unreachable\n");
+    }
+    return seconds * 1e9 / static_cast<double>(probes.size() / batch * batch);
+}
+
+void BenchBatch() {
+    constexpr size_t kEntries = 2'000'000;
+    constexpr size_t kLookups = 2'000'000;
+    std::mt19937_64 gen(kEntries);
+    std::vector<uint64_t> keys(kEntries);
+    for (auto &key : keys) {
+        key = gen();
+    }
+    std::vector<uint64_t> probes(kLookups);
+    for (auto &probe : probes) {
+        probe = keys[gen() % kEntries];
+    }
+
+    BasicLruCache<uint64_t, uint64_t> cache(kEntries);
+    cache.set_many(keys, keys);
+    BasicShardedLruCache<uint64_t, uint64_t> sharded(2 * kEntries);
+    sharded.set_many(keys, keys);
+
+    std::printf("%8s %16s %16s\n", "batch", "LruCache ns/key", "Sharded ns/key");
+    for (size_t batch : {1, 8, 32, 128, 1024}) {
+        const double cache_ns = MeasureBatchNanos(cache, probes, batch);
+        const double sharded_ns = MeasureBatchNanos(sharded, probes, batch);
+        std::printf("%8zu %16.1f %16.1f\n", batch, cache_ns, sharded_ns);
+    }
+}
+
+// Set LRU_BENCH_SNAPSHOT_ENTRIES to change the snapshot size; 10M entries need
+// about 4 GiB.
+void BenchSnapshot() {
+    size_t entries = 10'000'000;
+    if (const char *count = std::getenv("LRU_BENCH_SNAPSHOT_ENTRIES")) {
+        entries = std::strtoull(count, nullptr, 10);
+    }
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "lru_cache_bench.snapshot").string();
+    const auto keys = MakeKeys(entries);
+    const std::string value(16, 'v');
+
+    double set_seconds = 0;
+    double save_seconds = 0;
+    {
+        LruCache cache(entries);
+        set_seconds = MeasureSeconds([&] {
+            for (const auto &key : keys) {
+                cache.set(key, value);
+            }
+        });
+        save_seconds = MeasureSeconds([&] {
+            if (!cache.save(path)) {
+                std::printf("save failed\n");
+            }
+        });
+    }
+
+    LruCache restored(entries);
+    const double load_seconds = MeasureSeconds([&] {
+        if (!restored.load(path)) {
+            std::printf("load failed\n");
+        }
+    });
+    std::string found;
+    if (restored.size() != entries || !restored.get(keys.back(), &found)) {
+        std::printf("snapshot lost entries\n");
+    }
+
+    const auto ns_per_entry = [entries](double seconds) {
+        return seconds * 1e9 / static_cast<double>(entries);
+    };
+    std::printf("%12s %10s %14s %12s\n", "entries", "file MiB", "step", "seconds");
+    const double mib = static_cast<double>(std::filesystem::file_size(path)) / (1 << 20);
+    std::printf("%12zu %10.1f %14s %12.3f  (%.0f ns/entry)\n", entries, mib, "set() warm-up",
+                set_seconds, ns_per_entry(set_seconds));
+    std::printf("%12s %10s %14s %12.3f  (%.0f ns/entry)\n", "", "", "save()", save_seconds,
+                ns_per_entry(save_seconds));
+    std::printf("%12s %10s %14s %12.3f  (%.0f ns/entry)\n", "", "", "load()", load_seconds,
+                ns_per_entry(load_seconds));
+    std::filesystem::remove(path);
+}
+
+// Nanoseconds per operation of a 90% get / 10% set mix on one thread.
+template <typename Cache>
+double MeasureMixedNanos(const std::vector<std::string> &keys, size_t ops) {
+    Cache cache(keys.size() / 2);
+    return 1e3 / RunMixedWorkload(cache, keys, 1, ops);
+}
+
+void BenchStats() {
+    using StatsLruCache =
+        BasicLruCache<std::string, std::string, StringKeyHash, StringKeyEqual, CacheStats>;
+    using StatsShardedLruCache =
+        BasicShardedLruCache<std::string, std::string, StringKeyHash, StringKeyEqual, CacheStats>;
+    constexpr size_t kOps = 2'000'000;
+    const auto keys = MakeKeys(200'000);
+
+    std::printf("%18s %16s %16s\n", "cache", "no stats ns/op", "CacheStats ns/op");
+    std::printf("%18s %16.1f %16.1f\n", "LruCache", MeasureMixedNanos<LruCache>(keys, kOps),
+                MeasureMixedNanos<StatsLruCache>(keys, kOps));
+    std::printf("%18s %16.1f %16.1f\n", "ShardedLruCache",
+                MeasureMixedNanos<ShardedLruCache>(keys, kOps),
+                MeasureMixedNanos<StatsShardedLruCache>(keys, kOps));
+
+    StatsShardedLruCache cache(keys.size() / 2);
+    const double mops = RunMixedWorkload(cache, keys, 4, kOps / 4);
+    const auto stats = cache.stats();
+    std::printf("\n4 threads on a sharded cache with stats: %.2f Mop/s\n", mops);
+    std::printf("hits %llu, misses %llu, inserts %llu, updates %llu, evictions %llu, entries %llu, "
+                "bytes %llu\n",
+                static_cast<unsigned long long>(stats.hits),
+                static_cast<unsigned long long>(stats.misses),
+                static_cast<unsigned long long>(stats.inserts),
+                static_cast<unsigned long long>(stats.updates),
+                static_cast<unsigned long long>(stats.evictions),
+                static_cast<unsigned long long>(stats.entries),
+                static_cast<unsigned long long>(stats.bytes));
+}
+
+struct HerdResult {
+    size_t requests;
+    size_t backend_calls;
+    double seconds;
+};
+
+// `threads` threads read kHotKeys hot keys for `duration`. Entries live for
+// 20 ms, so the hot keys keep dropping out; every backend call takes 5 ms.
+// With `coalesce`, misses go through get_or_load(), otherwise every thread
+// that misses loads the value itself and set()s it.
+HerdResult RunThunderingHerd(size_t threads, bool coalesce, std::chrono::milliseconds duration) {
+    constexpr size_t kHotKeys = 4;
+    const auto keys = MakeKeys(kHotKeys);
+    ShardedLruCache cache(1'000);
+    cache.set_default_ttl(std::chrono::milliseconds(20));
+    std::atomic<size_t> requests{0};
+    std::atomic<size_t> backend_calls{0};
+    const auto backend = [&backend_calls](std::string_view key) {
+        backend_calls.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return std::string(key);
+    };
+
+    const auto deadline = Clock::now() + duration;
+    std::vector<std::thread> workers;
+    const double seconds = MeasureSeconds([&] {
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::string value;
+                for (size_t i = t; Clock::now() < deadline; ++i) {
+                    const auto &key = keys[i % kHotKeys];
+                    if (coalesce) {
+                        value = cache.get_or_load(key, backend);
+                    } else if (!cache.get(key, &value)) {
+                        value = backend(key);
+                        cache.set(key, value);
+                    }
+                    requests.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    });
+    return {requests.load(), backend_calls.load(), seconds};
+}
+
+void BenchThunderingHerd() {
+    constexpr auto kDuration = std::chrono::milliseconds(1'000);
+    std::printf("%8s %14s %10s %14s %14s\n", "threads", "mode", "requests", "backend calls",
+                "calls/second");
+    for (size_t threads : {8, 32, 128}) {
+        for (const bool coalesce : {false, true}) {
+            const auto result = RunThunderingHerd(threads, coalesce, kDuration);
+            std::printf("%8zu %14s %10zu %14zu %14.0f\n", threads,
+                        coalesce ? "get_or_load" : "get+set", result.requests,
+                        result.backend_calls,
+                        static_cast<double>(result.backend_calls) / result.seconds);
+        }
+    }
+}
+
+void BenchConcurrent() {
+    constexpr size_t kCapacity = 50'000;
+    constexpr size_t kOpsPerThread = 1'000'000;
+    constexpr size_t kSetPercent = 5;
+    const auto keys = MakeKeys(2 * kCapacity);
+
+    std::vector<size_t> thread_counts = {1, 2, 4, 8};
+    if (const size_t hw = std::thread::hardware_concurrency(); hw > 8) {
+        thread_counts.push_back(hw);
+    }
+
+    std::printf("%8s %18s %18s\n", "threads", "sharded Mop/s", "concurrent Mop/s");
+    for (auto threads : thread_counts) {
+        ShardedLruCache sharded(kCapacity);
+        ConcurrentLruCache concurrent(kCapacity);
+        const double sharded_mops =
+            RunMixedWorkload(sharded, keys, threads, kOpsPerThread, kSetPercent);
+        const double concurrent_mops =
+            RunMixedWorkload(concurrent, keys, threads, kOpsPerThread, kSetPercent);
+        std::printf("%8zu %18.2f %18.2f\n", threads, sharded_mops, concurrent_mops);
+    }
+}
+
+// Resident set size of the process according to /proc/self/statm.
+size_t ResidentBytes() {
+    size_t pages = 0;
+    size_t resident = 0;
+    if (FILE *statm = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(statm, "%zu %zu", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(statm);
+    }
+    return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+// Sets values whose size alternates between small and large phases, which
+// leaves a malloc heap with holes of the wrong size after every switch, and
+// prints the RSS the cache added after each phase.
+template <typename Cache>
+void RunChurn(Cache &cache, const char *engine, const std::vector<std::string> &keys,
+              size_t phases, size_t sets_per_phase) {
+    const size_t rss_before = ResidentBytes();
+    const std::string bytes(16 << 10, 'v');
+    std::mt19937_64 gen(1);
+    for (size_t phase = 0; phase < phases; ++phase) {
+        const bool small = phase % 2 == 0;
+        const double seconds = MeasureSeconds([&] {
+            for (size_t i = 0; i < sets_per_phase; ++i) {
+                const auto r = gen();
+                const size_t size = small ? 32 + (r >> 32) % 480 : 1024 + (r >> 32) % 15360;
+                cache.set(keys[r % keys.size()], std::string_view(bytes).substr(0, size));
+            }
+        });
+        std::printf("%8s %6zu %8s %12.1f %12.2f\n", engine, phase, small ? "small" : "large",
+                    static_cast<double>(ResidentBytes() - rss_before) / (1 << 20),
+                    static_cast<double>(sets_per_phase) / seconds / 1e6);
+    }
+}
+
+// Each engine runs in a child process, so that one does not inherit the heap
+// the other left behind.
+void BenchChurn() {
+    constexpr size_t kBudget = size_t{256} << 20;
+    constexpr size_t kPhases = 8;
+    constexpr size_t kSetsPerPhase = 500'000;
+    const auto keys = MakeKeys(1'000'000);
+
+    std::printf("budget %zu MiB\n%8s %6s %8s %12s %12s\n", kBudget >> 20, "engine", "phase",
+                "values", "RSS MiB", "Mset/s");
+    std::fflush(stdout);
+    for (const bool slab : {false, true}) {
+        const pid_t child = ::fork();
+        if (child == 0) {
+            if (slab) {
+                SlabLruCache cache(kBudget);
+                RunChurn(cache, "slab", keys, kPhases, kSetsPerPhase);
+            } else {
+                LruCache cache(kBudget, LruCache::byte_size);
+                RunChurn(cache, "malloc", keys, kPhases, kSetsPerPhase);
+            }
+            std::fflush(stdout);
+            std::_Exit(0);
+        }
+        ::waitpid(child, nullptr, 0);
+    }
+}
+
+struct Benchmark {
+    std::string_view name;
+    void (*run)();
+};
+
+constexpr Benchmark kBenchmarks[] = {
+    {"sharded", BenchShardedThroughput},
+    {"memory", BenchMemoryPerEntry},
+    {"hit", BenchHitLatency},
+    {"hit-ratio", BenchHitRatio},
+    {"typed", BenchTypedKeys},
+    {"lookup", BenchLookupLatency},
+    {"clock", BenchClock},
+    {"batch", BenchBatch},
+    {"snapshot", BenchSnapshot},
+    {"stats", BenchStats},
+    {"herd", BenchThunderingHerd},
+    {"concurrent", BenchConcurrent},
+    {"churn", BenchChurn},
+    {"arc", BenchArc},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    for (const auto &benchmark : kBenchmarks) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || benchmark.name == argv[i];
+        }
+        if (selected) {
+            std::printf("== %s\n", benchmark.name.data());
+            benchmark.run();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#ifndef CACHE_STATS_H
+
+#define CACHE_STATS_H
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Counters exported by a cache's stats(). Entries and bytes are what the cache
+// holds at the time of the call, the other fields count events since it was
+// built. Bytes are the key and value payload: the size of strings and string
+// views, sizeof of anything else.
+struct CacheStatsSnapshot {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t inserts{0};
+    uint64_t updates{0};
+    // Entries dropped to make room.
+    uint64_t evictions{0};
+    // Entries dropped because their TTL passed.
+    uint64_t expirations{0};
+    uint64_t entries{0};
+    uint64_t bytes{0};
+};
+
+// Stats policy that records nothing. Every call is an empty inline function,
+// so a cache built with it compiles to the same code as one without counters.
+struct NoCacheStats {
+    static constexpr bool kEnabled = false;
+
+    void hit() {}
+    void miss() {}
+    void inserted(size_t /*bytes*/) {}
+    void updated(size_t /*old_bytes*/, size_t /*new_bytes*/) {}
+    void removed(size_t /*bytes*/) {}
+    void evicted() {}
+    void expired() {}
+};
+
+// Stats policy with relaxed atomic counters. Counters are only written by the
+// thread that holds the cache (or its shard), so bumping one is a plain load
+// and store without a locked instruction; the atomics just let any other
+// thread call snapshot() at the same time.
+class CacheStats {
+public:
+    static constexpr bool kEnabled = true;
+
+    void hit() { bump(hits_); }
+    void miss() { bump(misses_); }
+
+    void inserted(size_t bytes) {
+        bump(inserts_);
+        bump(entries_);
+        bump(bytes_, bytes);
+    }
+
+    void updated(size_t old_bytes, size_t new_bytes) {
+        bump(updates_);
+        bump(bytes_, new_bytes - old_bytes);
+    }
+
+    void removed(size_t bytes) {
+        bump(entries_, uint64_t{0} - 1);
+        bump(bytes_, uint64_t{0} - bytes);
+    }
+
+    void evicted() { bump(evictions_); }
+    void expired() { bump(expirations_); }
+
+    [[nodiscard]] CacheStatsSnapshot snapshot() const {
+        CacheStatsSnapshot stats;
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        stats.misses = misses_.load(std::memory_order_relaxed);
+        stats.inserts = inserts_.load(std::memory_order_relaxed);
+        stats.updates = updates_.load(std::memory_order_relaxed);
+        stats.evictions = evictions_.load(std::memory_order_relaxed);
+        stats.expirations = expirations_.load(std::memory_order_relaxed);
+        stats.entries = entries_.load(std::memory_order_relaxed);
+        stats.bytes = bytes_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    // Wraps around on purpose, so that subtracting is adding the complement.
+    static void bump(std::atomic<uint64_t> &counter, uint64_t delta = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> inserts_{0};
+    std::atomic<uint64_t> updates_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> expirations_{0};
+    std::atomic<uint64_t> entries_{0};
+    std::atomic<uint64_t> bytes_{0};
+};
+
+// Payload bytes of a key or value as counted by CacheStats.
+template <typename T>
+size_t payload_bytes(const T &field) {
+    if constexpr (std::convertible_to<const T &, std::string_view>) {
+        return std::string_view(field).size();
+    } else {
+        return sizeof(T);
+    }
+}
+
+inline CacheStatsSnapshot &operator+=(CacheStatsSnapshot &total, const CacheStatsSnapshot &part) {
+    total.hits += part.hits;
+    total.misses += part.misses;
+    total.inserts += part.inserts;
+    total.updates += part.updates;
+    total.evictions += part.evictions;
+    total.expirations += part.expirations;
+    total.entries += part.entries;
+    total.bytes += part.bytes;
+    return total;
+}
+#endif
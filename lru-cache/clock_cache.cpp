@@ -0,0 +1,3 @@
+#include "clock_cache.h"
+
+template class BasicClockCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
@@ -0,0 +1,127 @@
+#ifndef CLOCK_CACHE_H
+
+#define CLOCK_CACHE_H
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "flat_index.h"
+#include "string_key.h"
+
+// CLOCK (second chance) approximation of LRU with the set()/get() contract of
+// BasicLruCache. Entries sit in a ring of max_size slots. A hit only sets the
+// entry's reference bit; there is no list to relink. To make room, a hand
+// sweeps the ring, clearing set bits and evicting the first entry whose bit
+// is already clear.
+//
+// Since get() writes nothing but a relaxed atomic bit, any number of get()
+// calls may run concurrently (e.g. under the shared side of a
+// std::shared_mutex); set() still needs exclusive access.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class BasicClockCache {
+public:
+    explicit BasicClockCache(size_t max_size)
+        : ring_(std::make_unique<Entry *[]>(max_size)), max_size_(max_size) {
+        index_.reserve(max_size);
+    }
+
+    BasicClockCache(const BasicClockCache &) = delete;
+    ~BasicClockCache() {
+        for (size_t i = 0; i < index_.size(); ++i) {
+            delete ring_[i];
+        }
+    }
+    BasicClockCache(BasicClockCache &&) = delete;
+    BasicClockCache &operator=(const BasicClockCache &) = delete;
+    BasicClockCache &operator=(const BasicClockCache &&) = delete;
+
+    template <typename K, typename V>
+        requires std::constructible_from<Key, const K &> && std::constructible_from<Value, V &&>
+    void set(const K &key, V &&value) {
+        const size_t hash = hash_(key);
+        if (Entry *entry = index_.find(hash, matches(key)); entry != nullptr) {
+            entry->value = std::forward<V>(value);
+            entry->referenced.store(true, std::memory_order_relaxed);
+            return;
+        }
+        if (max_size_ == 0) {
+            return;
+        }
+        // New entries start unreferenced, so a one-hit key is the next victim
+        // unless it is read before the hand comes around.
+        auto *entry = new Entry(hash, key, std::forward<V>(value));
+        size_t slot = index_.size();
+        if (slot == max_size_) {
+            slot = advance_hand();
+            index_.erase(ring_[slot]);
+            delete ring_[slot];
+        }
+        ring_[slot] = entry;
+        index_.insert(entry);
+    }
+
+    template <typename K>
+        requires std::constructible_from<Key, const K &>
+    bool get(const K &key, Value *value) const {
+        const Entry *entry = index_.find(hash_(key), matches(key));
+        if (entry == nullptr) {
+            return false;
+        }
+        // Only store when the bit is clear, so hot entries are not written to
+        // (and their cache line not invalidated) on every hit.
+        if (!entry->referenced.load(std::memory_order_relaxed)) {
+            entry->referenced.store(true, std::memory_order_relaxed);
+        }
+        *value = entry->value;
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const { return index_.size(); }
+
+private:
+    struct Entry {
+        template <typename K, typename V>
+        Entry(size_t hash, const K &key, V &&value)
+            : hash(hash), key(key), value(std::forward<V>(value)) {}
+
+        size_t hash;
+        Key key;
+        Value value;
+        mutable std::atomic<bool> referenced{false};
+    };
+
+    template <typename K>
+    auto matches(const K &key) const {
+        return [this, &key](const Entry &entry) { return equal_(entry.key, key); };
+    }
+
+    // Sweeps the hand to the next unreferenced entry, giving referenced ones a
+    // second chance, and returns its slot. The hand then points past it.
+    size_t advance_hand() {
+        for (;;) {
+            const size_t slot = hand_;
+            hand_ = hand_ + 1 == max_size_ ? 0 : hand_ + 1;
+            if (!ring_[slot]->referenced.exchange(false, std::memory_order_relaxed)) {
+                return slot;
+            }
+        }
+    }
+
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] KeyEqual equal_;
+    FlatIndex<Entry> index_;
+    std::unique_ptr<Entry *[]> ring_;
+    size_t hand_{0};
+    size_t max_size_{0};
+};
+
+using ClockCache = BasicClockCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
+
+extern template class BasicClockCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
+#endif
@@ -0,0 +1,3 @@
+#include "concurrent_lru_cache.h"
+
+template class BasicConcurrentLruCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
@@ -0,0 +1,237 @@
+#ifndef CONCURRENT_LRU_CACHE_H
+
+#define CONCURRENT_LRU_CACHE_H
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "epoch.h"
+#include "recency_list.h"
+#include "string_key.h"
+
+// Thread-safe LRU cache for read-mostly workloads, with the set()/get()
+// contract of BasicLruCache and entry-count capacity only.
+//
+// get() is lock-free, not wait-free: it takes no lock and pins an epoch,
+// which retries if a writer advances the epoch meanwhile, then walks a bucket
+// chain of immutable entries and copies the value out. The only shared state
+// it writes is the reader counter and hit ring of its stripe, which readers
+// of other stripes never touch. Entries are never modified after they are
+// published; set() on an existing key swaps in a new entry, and replaced or
+// evicted entries are handed to an EpochReclaimer, which deletes them once
+// no reader can still see them.
+//
+// Recency is updated lazily. A hit is recorded in a small ring buffer of the
+// reader's stripe and the rings are drained in batches under the writer
+// mutex, by set() or by the reader that fills a ring. A full ring drops
+// further hits until it is drained, so eviction order is approximately LRU,
+// skewed towards recently drained hits.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class BasicConcurrentLruCache {
+public:
+    explicit BasicConcurrentLruCache(size_t max_size, size_t stripes = DefaultStripes())
+        : buckets_(std::make_unique<std::atomic<const Entry *>[]>(BucketCount(max_size))),
+          bucket_mask_(BucketCount(max_size) - 1),
+          buffers_(std::make_unique<AccessBuffer[]>(std::bit_ceil(std::max<size_t>(stripes, 1)))),
+          buffer_mask_(std::bit_ceil(std::max<size_t>(stripes, 1)) - 1),
+          reclaimer_(stripes),
+          max_size_(max_size) {}
+
+    BasicConcurrentLruCache(const BasicConcurrentLruCache &) = delete;
+    ~BasicConcurrentLruCache() {
+        for (const Entry *entry = lru_.front(); entry != nullptr;) {
+            delete std::exchange(entry, entry->next);
+        }
+    }
+    BasicConcurrentLruCache(BasicConcurrentLruCache &&) = delete;
+    BasicConcurrentLruCache &operator=(const BasicConcurrentLruCache &) = delete;
+    BasicConcurrentLruCache &operator=(const BasicConcurrentLruCache &&) = delete;
+
+    template <typename K, typename V>
+        requires std::constructible_from<Key, const K &> && std::constructible_from<Value, V &&>
+    void set(const K &key, V &&value) {
+        if (max_size_ == 0) {
+            return;
+        }
+        const size_t hash = hash_(key);
+        // Built before taking the lock, which only covers relinking.
+        const auto *entry = new Entry(hash, key, std::forward<V>(value));
+        const std::lock_guard lock(mutex_);
+        drain_accesses();
+        if (auto *link = find_link(hash, [&](const Entry &other) { return equal_(other.key, key); });
+            link != nullptr) {
+            const Entry *old = link->load(std::memory_order_relaxed);
+            entry->chain_next.store(old->chain_next.load(std::memory_order_relaxed),
+                                    std::memory_order_relaxed);
+            link->store(entry, std::memory_order_release);
+            lru_.remove(old);
+            lru_.push_back(entry);
+            reclaimer_.retire(old);
+            return;
+        }
+        auto &head = bucket(hash);
+        entry->chain_next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        head.store(entry, std::memory_order_release);
+        lru_.push_back(entry);
+        if (lru_.size() > max_size_) {
+            evict(lru_.front());
+        }
+        size_.store(lru_.size(), std::memory_order_relaxed);
+    }
+
+    // Lock-free, not wait-free; may run concurrently with any other call.
+    template <typename K>
+        requires std::constructible_from<Key, const K &>
+    bool get(const K &key, Value *value) {
+        const size_t hash = hash_(key);
+        const auto guard = reclaimer_.pin();
+        for (const Entry *entry = bucket(hash).load(std::memory_order_acquire); entry != nullptr;
+             entry = entry->chain_next.load(std::memory_order_acquire)) {
+            if (entry->hash == hash && equal_(entry->key, key)) {
+                *value = entry->value;
+                record_access(entry);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        template <typename K, typename V>
+        Entry(size_t hash, const K &key, V &&value)
+            : hash(hash), key(key), value(std::forward<V>(value)) {}
+
+        const size_t hash;
+        const Key key;
+        const Value value;
+        // Bucket chain, read by get() without the lock.
+        mutable std::atomic<const Entry *> chain_next{nullptr};
+        // RecencyList links, only touched under the writer mutex.
+        mutable const Entry *prev{nullptr};
+        mutable const Entry *next{nullptr};
+    };
+
+    // Ring of recent hits for the readers of one stripe. Readers claim a slot
+    // by advancing `write` and fill it; the drain consumes slots up to the
+    // first one not filled yet and advances `read`. The hash is kept next to
+    // the entry so the drain can check that the entry is still in the cache
+    // without dereferencing it: it may have been evicted and deleted since.
+    static constexpr size_t kAccessBufferSize = 32;
+
+    struct AccessSlot {
+        size_t hash{0};
+        std::atomic<const Entry *> entry{nullptr};
+    };
+
+    struct alignas(64) AccessBuffer {
+        std::atomic<size_t> write{0};
+        std::atomic<size_t> read{0};
+        AccessSlot slots[kAccessBufferSize];
+    };
+
+    static size_t DefaultStripes() { return std::max<size_t>(std::thread::hardware_concurrency(), 1); }
+
+    // At most one entry per bucket on average; the table never grows.
+    static size_t BucketCount(size_t max_size) { return std::bit_ceil(std::max<size_t>(max_size, 1)); }
+
+    std::atomic<const Entry *> &bucket(size_t hash) const {
+        // std::hash of integers is the identity; spread it over all bits.
+        uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL;
+        return buckets_[(mixed ^ (mixed >> 32)) & bucket_mask_];
+    }
+
+    // The link pointing at the entry of this bucket for which matches(entry)
+    // holds, or nullptr. Writer side only.
+    template <typename Matches>
+    std::atomic<const Entry *> *find_link(size_t hash, Matches &&matches) const {
+        std::atomic<const Entry *> *link = &bucket(hash);
+        for (const Entry *entry; (entry = link->load(std::memory_order_relaxed)) != nullptr;
+             link = &entry->chain_next) {
+            if (entry->hash == hash && matches(*entry)) {
+                return link;
+            }
+        }
+        return nullptr;
+    }
+
+    // Called by get() while its epoch is still pinned.
+    void record_access(const Entry *entry) {
+        AccessBuffer &buffer = buffers_[this_thread_index() & buffer_mask_];
+        size_t write = buffer.write.load(std::memory_order_relaxed);
+        const size_t read = buffer.read.load(std::memory_order_acquire);
+        if (write - read >= kAccessBufferSize ||
+            !buffer.write.compare_exchange_strong(write, write + 1, std::memory_order_relaxed)) {
+            // Full, or another reader of the stripe raced us: drop the hit.
+            return;
+        }
+        AccessSlot &slot = buffer.slots[write % kAccessBufferSize];
+        slot.hash = entry->hash;
+        slot.entry.store(entry, std::memory_order_release);
+        // The hit that fills the ring drains it, unless a writer is busy and
+        // will drain it anyway.
+        if (write + 1 - read == kAccessBufferSize && mutex_.try_lock()) {
+            drain_accesses();
+            mutex_.unlock();
+        }
+    }
+
+    // Applies the recorded hits to the recency list. Writer side only.
+    void drain_accesses() {
+        for (size_t i = 0; i <= buffer_mask_; ++i) {
+            AccessBuffer &buffer = buffers_[i];
+            size_t read = buffer.read.load(std::memory_order_relaxed);
+            const size_t write = buffer.write.load(std::memory_order_acquire);
+            for (; read != write; ++read) {
+                AccessSlot &slot = buffer.slots[read % kAccessBufferSize];
+                const Entry *entry = slot.entry.load(std::memory_order_acquire);
+                if (entry == nullptr) {
+                    break;
+                }
+                if (find_link(slot.hash, [entry](const Entry &other) { return &other == entry; }) !=
+                    nullptr) {
+                    lru_.move_to_back(entry);
+                }
+                slot.entry.store(nullptr, std::memory_order_relaxed);
+            }
+            buffer.read.store(read, std::memory_order_release);
+        }
+    }
+
+    void evict(const Entry *entry) {
+        auto *link = find_link(entry->hash, [entry](const Entry &other) { return &other == entry; });
+        link->store(entry->chain_next.load(std::memory_order_relaxed), std::memory_order_release);
+        lru_.remove(entry);
+        reclaimer_.retire(entry);
+    }
+
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] KeyEqual equal_;
+    std::unique_ptr<std::atomic<const Entry *>[]> buckets_;
+    size_t bucket_mask_;
+    std::unique_ptr<AccessBuffer[]> buffers_;
+    size_t buffer_mask_;
+    EpochReclaimer<Entry> reclaimer_;
+    // Serializes set() and drains.
+    std::mutex mutex_;
+    RecencyList<Entry> lru_;
+    std::atomic<size_t> size_{0};
+    size_t max_size_;
+};
+
+using ConcurrentLruCache = BasicConcurrentLruCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
+
+extern template class BasicConcurrentLruCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
+#endif
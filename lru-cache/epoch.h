@@ -0,0 +1,131 @@
+#ifndef EPOCH_H
+
+#define EPOCH_H
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Small dense number of the calling thread, assigned on first use. Lock-free
+// structures use it to pick a per-thread stripe of their state.
+inline size_t this_thread_index() {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+// Epoch-based reclamation of Node objects that lock-free readers may still be
+// looking at after a writer unlinked them.
+//
+// Readers pin() the current epoch for the duration of a lookup. Writers, which
+// must be serialized by the caller, retire() what they unlink into the list of
+// the current epoch. The global epoch only moves from e to e + 1 once no
+// reader is pinned at e - 1, so when it reaches e + 2 every reader that could
+// have seen a node retired during e is gone and the node is deleted.
+//
+// Pinned readers are counted per stripe and per epoch parity rather than
+// registered per thread: a pin is an increment of a counter on the caller's
+// own cache line, threads never need to register or unregister, and two
+// threads that land on the same stripe just share the counter.
+template <typename Node>
+class EpochReclaimer {
+public:
+    class Guard {
+    public:
+        Guard(const Guard &) = delete;
+        Guard(Guard &&) = delete;
+        Guard &operator=(const Guard &) = delete;
+        Guard &operator=(Guard &&) = delete;
+        ~Guard() { counter_.fetch_sub(1, std::memory_order_release); }
+
+    private:
+        friend class EpochReclaimer;
+
+        explicit Guard(std::atomic<uint64_t> &counter) : counter_(counter) {}
+
+        std::atomic<uint64_t> &counter_;
+    };
+
+    explicit EpochReclaimer(size_t stripes)
+        : stripes_(std::make_unique<Stripe[]>(std::bit_ceil(std::max<size_t>(stripes, 1)))),
+          stripe_mask_(std::bit_ceil(std::max<size_t>(stripes, 1)) - 1) {}
+
+    EpochReclaimer(const EpochReclaimer &) = delete;
+    EpochReclaimer(EpochReclaimer &&) = delete;
+    EpochReclaimer &operator=(const EpochReclaimer &) = delete;
+    EpochReclaimer &operator=(EpochReclaimer &&) = delete;
+    // No reader may be pinned any more.
+    ~EpochReclaimer() {
+        for (auto &retired : retired_) {
+            for (const Node *node : retired) {
+                delete node;
+            }
+        }
+    }
+
+    // Nodes reachable when pin() returns stay allocated until the guard dies.
+    [[nodiscard]] Guard pin() {
+        Stripe &stripe = stripes_[this_thread_index() & stripe_mask_];
+        for (;;) {
+            const uint64_t epoch = epoch_.load();
+            stripe.readers[epoch & 1].fetch_add(1);
+            // If a writer advanced in between, it may have checked this
+            // counter already; back off and pin the new epoch instead.
+            if (epoch_.load() == epoch) {
+                return Guard(stripe.readers[epoch & 1]);
+            }
+            stripe.readers[epoch & 1].fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // Writer side: node is no longer reachable from the shared structure.
+    // Every kCollectBatch retirements, tries to advance the epoch.
+    void retire(const Node *node) {
+        auto &retired = retired_[epoch_.load(std::memory_order_relaxed) % 3];
+        retired.push_back(node);
+        if (retired.size() % kCollectBatch == 0) {
+            collect();
+        }
+    }
+
+    // Writer side: moves to the next epoch and deletes the nodes retired two
+    // epochs before it, unless a reader is still pinned at the previous one.
+    bool collect() {
+        const uint64_t epoch = epoch_.load(std::memory_order_relaxed) + 1;
+        for (size_t i = 0; i <= stripe_mask_; ++i) {
+            if (stripes_[i].readers[epoch & 1].load() != 0) {
+                return false;
+            }
+        }
+        epoch_.store(epoch);
+        auto &expired = retired_[(epoch + 1) % 3];
+        for (const Node *node : expired) {
+            delete node;
+        }
+        expired.clear();
+        return true;
+    }
+
+    // Retired nodes not deleted yet.
+    [[nodiscard]] size_t pending() const {
+        return retired_[0].size() + retired_[1].size() + retired_[2].size();
+    }
+
+private:
+    // Checking the readers touches every stripe, so it is done once per batch.
+    static constexpr size_t kCollectBatch = 64;
+
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> readers[2]{};
+    };
+
+    std::atomic<uint64_t> epoch_{0};
+    std::unique_ptr<Stripe[]> stripes_;
+    size_t stripe_mask_;
+    // By epoch modulo 3: the current one and the two before it.
+    std::vector<const Node *> retired_[3];
+};
+#endif
@@ -0,0 +1,198 @@
+#ifndef FLAT_INDEX_H
+
+#define FLAT_INDEX_H
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Open-addressing hash index of Node pointers in the style of a Swiss table.
+// Every slot has a control byte: empty, deleted, or the low 7 bits of the
+// node's hash. Lookups scan a group of 16 control bytes at once (with SSE2 when
+// available) and only dereference nodes whose 7-bit tag matches, so a hit
+// usually costs one control-byte line, one slot and the node itself.
+//
+// The index does not own its nodes. Node must expose the full hash of its key
+// as `size_t hash`; it is needed again on erase and rehash, which thus never
+// touch keys.
+template <typename Node>
+class FlatIndex {
+public:
+    FlatIndex() = default;
+
+    FlatIndex(const FlatIndex &) = delete;
+    FlatIndex(FlatIndex &&) = delete;
+    FlatIndex &operator=(const FlatIndex &) = delete;
+    FlatIndex &operator=(FlatIndex &&) = delete;
+    ~FlatIndex() = default;
+
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] size_t capacity() const { return capacity_; }
+
+    // Returns the node with this hash for which matches(node) holds.
+    template <typename Matches>
+    Node *find(size_t hash, Matches &&matches) const {
+        if (capacity_ == 0) {
+            return nullptr;
+        }
+        const uint64_t mixed = Mix(hash);
+        const auto tag = static_cast<uint8_t>(mixed & 0x7F);
+        size_t group = (mixed >> 7) & group_mask();
+        for (size_t step = 1;; ++step) {
+            const uint8_t *ctrl = &ctrl_[group * kGroupSize];
+            for (uint32_t bits = Match(ctrl, tag); bits != 0; bits &= bits - 1) {
+                Node *node = slots_[group * kGroupSize + std::countr_zero(bits)];
+                if (node->hash == hash && matches(*node)) {
+                    return node;
+                }
+            }
+            if (Match(ctrl, kEmpty) != 0) {
+                return nullptr;
+            }
+            group = (group + step) & group_mask();
+        }
+    }
+
+    // Starts loading the first group find(hash, ...) will probe.
+    void prefetch(size_t hash) const {
+        if (capacity_ != 0) {
+            const size_t group = (Mix(hash) >> 7) & group_mask();
+            __builtin_prefetch(&ctrl_[group * kGroupSize]);
+            __builtin_prefetch(&slots_[group * kGroupSize]);
+        }
+    }
+
+    // The caller guarantees that no equal node is present.
+    void insert(Node *node) {
+        if (growth_left_ == 0) {
+            // Mostly tombstones: rehashing in place reclaims them.
+            rehash(size_ * 2 < capacity_ * 7 / 8 ? capacity_ : std::max(capacity_ * 2, kGroupSize));
+        }
+        place(node);
+        ++size_;
+    }
+
+    void erase(const Node *node) {
+        const uint64_t mixed = Mix(node->hash);
+        const auto tag = static_cast<uint8_t>(mixed & 0x7F);
+        size_t group = (mixed >> 7) & group_mask();
+        for (size_t step = 1;; ++step) {
+            uint8_t *ctrl = &ctrl_[group * kGroupSize];
+            for (uint32_t bits = Match(ctrl, tag); bits != 0; bits &= bits - 1) {
+                const auto slot = group * kGroupSize + std::countr_zero(bits);
+                if (slots_[slot] == node) {
+                    // A group that still has an empty slot never made a probe
+                    // continue past it, so the slot can become empty again.
+                    if (Match(ctrl, kEmpty) != 0) {
+                        ctrl_[slot] = kEmpty;
+                        ++growth_left_;
+                    } else {
+                        ctrl_[slot] = kDeleted;
+                    }
+                    --size_;
+                    return;
+                }
+            }
+            group = (group + step) & group_mask();
+        }
+    }
+
+    // Makes room for `count` nodes without further rehashing.
+    void reserve(size_t count) {
+        const size_t needed = std::bit_ceil(std::max((count * 8 + 6) / 7, kGroupSize));
+        if (needed > capacity_) {
+            rehash(needed);
+        }
+    }
+
+private:
+    static constexpr size_t kGroupSize = 16;
+    static constexpr uint8_t kEmpty = 0x80;
+    static constexpr uint8_t kDeleted = 0xFE;
+
+    static uint64_t Mix(size_t hash) {
+        // std::hash of integers is the identity; spread it over all bits.
+        uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL;
+        return mixed ^ (mixed >> 32);
+    }
+
+    // Bit i is set iff ctrl[i] == value.
+    static uint32_t Match(const uint8_t *ctrl, uint8_t value) {
+#ifdef __SSE2__
+        const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+        return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(value)))));
+#else
+        uint32_t bits = 0;
+        for (size_t i = 0; i < kGroupSize; ++i) {
+            bits |= static_cast<uint32_t>(ctrl[i] == value) << i;
+        }
+        return bits;
+#endif
+    }
+
+    // Empty or deleted, i.e. any control byte with the high bit set.
+    static uint32_t MatchFree(const uint8_t *ctrl) {
+#ifdef __SSE2__
+        const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(group));
+#else
+        uint32_t bits = 0;
+        for (size_t i = 0; i < kGroupSize; ++i) {
+            bits |= static_cast<uint32_t>(ctrl[i] >> 7) << i;
+        }
+        return bits;
+#endif
+    }
+
+    [[nodiscard]] size_t group_mask() const { return capacity_ / kGroupSize - 1; }
+
+    void place(Node *node) {
+        const uint64_t mixed = Mix(node->hash);
+        size_t group = (mixed >> 7) & group_mask();
+        for (size_t step = 1;; ++step) {
+            const uint32_t free = MatchFree(&ctrl_[group * kGroupSize]);
+            if (free != 0) {
+                const auto slot = group * kGroupSize + std::countr_zero(free);
+                if (ctrl_[slot] == kEmpty) {
+                    --growth_left_;
+                }
+                ctrl_[slot] = static_cast<uint8_t>(mixed & 0x7F);
+                slots_[slot] = node;
+                return;
+            }
+            group = (group + step) & group_mask();
+        }
+    }
+
+    void rehash(size_t capacity) {
+        auto old_ctrl = std::move(ctrl_);
+        auto old_slots = std::move(slots_);
+        const size_t old_capacity = capacity_;
+
+        ctrl_ = std::make_unique_for_overwrite<uint8_t[]>(capacity);
+        slots_ = std::make_unique_for_overwrite<Node *[]>(capacity);
+        std::memset(ctrl_.get(), kEmpty, capacity);
+        capacity_ = capacity;
+        growth_left_ = capacity * 7 / 8;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if ((old_ctrl[i] & 0x80) == 0) {
+                place(old_slots[i]);
+            }
+        }
+    }
+
+    std::unique_ptr<uint8_t[]> ctrl_;
+    std::unique_ptr<Node *[]> slots_;
+    size_t capacity_{0};
+    size_t size_{0};
+    // Empty slots that may still be filled before the load factor of 7/8 is hit.
+    size_t growth_left_{0};
+};
+#endif
@@ -0,0 +1,65 @@
+#include "frequency_sketch.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+constexpr uint64_t kSeeds[] = {0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+                               0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+
+uint64_t Mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+}  // namespace
+
+FrequencySketch::FrequencySketch(size_t capacity)
+    : table_(std::bit_ceil(std::max<size_t>(capacity, 16))),
+      sample_size_(10 * std::max<size_t>(capacity, 1)) {}
+
+void FrequencySketch::increment(uint64_t hash) {
+    bool added = false;
+    for (int row = 0; row < kRows; ++row) {
+        auto &word = table_[word_of(hash, row)];
+        const unsigned offset = offset_of(hash, row);
+        if (((word >> offset) & 0xF) < kMaxFrequency) {
+            word += uint64_t{1} << offset;
+            added = true;
+        }
+    }
+    if (added && ++additions_ >= sample_size_) {
+        age();
+    }
+}
+
+uint8_t FrequencySketch::frequency(uint64_t hash) const {
+    uint8_t frequency = kMaxFrequency;
+    for (int row = 0; row < kRows; ++row) {
+        const auto counter = (table_[word_of(hash, row)] >> offset_of(hash, row)) & 0xF;
+        frequency = std::min(frequency, static_cast<uint8_t>(counter));
+    }
+    return frequency;
+}
+
+size_t FrequencySketch::word_of(uint64_t hash, int row) const {
+    return Mix(hash + kSeeds[row]) & (table_.size() - 1);
+}
+
+unsigned FrequencySketch::offset_of(uint64_t hash, int row) {
+    // Rows use disjoint quarters of a word, so the rows of one key never share
+    // a counter.
+    return static_cast<unsigned>((row << 4) + ((hash >> (row << 2)) & 3) * 4);
+}
+
+void FrequencySketch::age() {
+    for (auto &word : table_) {
+        word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    additions_ /= 2;
+}
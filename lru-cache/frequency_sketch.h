@@ -0,0 +1,39 @@
+#ifndef FREQUENCY_SKETCH_H
+
+#define FREQUENCY_SKETCH_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Count-min sketch of 4-bit counters used by TinyLfuCache to estimate how often
+// a key has been seen. Sixteen counters are packed per 64-bit word and each key
+// touches one counter in each of four rows. After sample_size() increments every
+// counter is halved, so the estimate follows the recent popularity of a key
+// instead of its all-time count.
+class FrequencySketch {
+public:
+    static constexpr uint8_t kMaxFrequency = 15;
+
+    // Sized for a cache of `capacity` entries.
+    explicit FrequencySketch(size_t capacity);
+
+    void increment(uint64_t hash);
+
+    [[nodiscard]] uint8_t frequency(uint64_t hash) const;
+
+    [[nodiscard]] size_t sample_size() const { return sample_size_; }
+
+private:
+    static constexpr int kRows = 4;
+
+    // Index of the word and bit offset of the counter of `hash` in `row`.
+    [[nodiscard]] size_t word_of(uint64_t hash, int row) const;
+    static unsigned offset_of(uint64_t hash, int row);
+
+    void age();
+
+    std::vector<uint64_t> table_;
+    size_t additions_{0};
+    size_t sample_size_{0};
+};
+#endif
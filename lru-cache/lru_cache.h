@@ -1,31 +1,615 @@
 #ifndef LRU_CACHE_H
 
 #define LRU_CACHE_H
+#include <algorithm>
+#include <chrono>
+#include <concepts>
 #include <cstddef>
-#include <list>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <ranges>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 
-class LruCache {
+#include "cache_stats.h"
+#include "flat_index.h"
+#include "recency_list.h"
+#include "snapshot.h"
+#include "string_key.h"
+#include "string_view.h"
+#include "timing_wheel.h"
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual, typename Stats>
+class BasicShardedLruCache;
+
+// LRU cache of Key -> Value. Keys are looked up with whatever Hash and KeyEqual
+// accept: with transparent ones (see LruCache below) get() and set() can be
+// probed with a view of the key, and a Key is only built when set() inserts a
+// new entry.
+//
+// By default the capacity is a number of entries. Given a weigher, it is a
+// budget of weight instead: every entry is charged weigher(key, value) and
+// entries are evicted from the LRU end until a new one fits.
+//
+// Entries may also carry a time to live, given per set() call or as a default.
+// get() treats an expired entry as a miss and drops it. Expired entries nobody
+// asks for are reclaimed by a TimingWheel that set() advances by a few entries
+// per call; expire() advances it explicitly.
+//
+// save() and load() write the cache to a snapshot file and warm up an empty one
+// from it, e.g. across a restart.
+//
+// An eviction listener receives the entries that set() drops for lack of room.
+//
+// Stats is NoCacheStats, which compiles all counting away, or CacheStats, which
+// keeps hit, miss, insert, update, eviction and size counters that stats()
+// exports.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, typename Stats = NoCacheStats>
+class BasicLruCache {
 public:
-    explicit LruCache(size_t max_size) : max_size_(max_size) {}
+    using Weigher = std::function<size_t(const Key &key, const Value &value)>;
+    // Current time in milliseconds since an arbitrary epoch.
+    using Clock = std::function<uint64_t()>;
+    using EvictionListener = std::function<void(Key &&key, Value &&value)>;
+
+    // Timing wheel work, in entries expired or moved between its levels,
+    // that set() does per call. Empty ticks are skipped for free.
+    static constexpr size_t kExpireStepsPerSet = 8;
+    // Keys that get_many() and set_many() hash and prefetch ahead at a time.
+    static constexpr size_t kBatchSize = 32;
+
+    // Weigher charging an entry its key and value bytes, making the capacity
+    // a byte budget.
+    static size_t byte_size(std::string_view key, std::string_view value) {
+        return key.size() + value.size();
+    }
+
+    explicit BasicLruCache(size_t max_size) : max_size_(max_size) {}
+
+    BasicLruCache(size_t max_weight, Weigher weigher)
+        : weigher_(std::move(weigher)), max_size_(max_weight) {}
+
+    BasicLruCache(const BasicLruCache &) = delete;
+    ~BasicLruCache() {
+        while (!lru_.empty()) {
+            const Entry *entry = lru_.front();
+            lru_.remove(entry);
+            delete entry;
+        }
+    }
+    BasicLruCache(BasicLruCache &&) = delete;
+    BasicLruCache &operator=(const BasicLruCache &) = delete;
+    BasicLruCache &operator=(const BasicLruCache &&) = delete;
+
+    static uint64_t steady_clock_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // TTL of entries stored by set() without an explicit one; zero, the
+    // default, means they never expire.
+    void set_default_ttl(std::chrono::milliseconds ttl) { default_ttl_ = ttl; }
+
+    // Replaces steady_clock_ms, e.g. with a manual clock in tests.
+    void set_clock(Clock clock) { clock_ = std::move(clock); }
+
+    // Receives, by move, the key and value of every entry dropped for lack of
+    // room, including a new one that could never fit; e.g. to spill it to a
+    // second tier or to write it back. Expired entries are dropped without a
+    // call. The listener runs once the set() that evicted has finished
+    // changing the cache, so it may use the cache itself; it must not throw.
+    void set_eviction_listener(EvictionListener listener) { listener_ = std::move(listener); }
+
+    template <typename K, typename V>
+        requires std::constructible_from<Key, const K &> && std::constructible_from<Value, V &&>
+    void set(const K &key, V &&value) {
+        set(key, std::forward<V>(value), default_ttl_);
+    }
+
+    // Stores an entry that expires `ttl` from now; a zero ttl never expires.
+    template <typename K, typename V>
+        requires std::constructible_from<Key, const K &> && std::constructible_from<Value, V &&>
+    void set(const K &key, V &&value, std::chrono::milliseconds ttl) {
+        set_hashed(hash_(key), key, std::forward<V>(value), ttl);
+        notify_evicted(std::exchange(evicted_, nullptr));
+    }
+
+    // Batched set() of keys[i] -> values[i] with the default TTL. As in
+    // get_many(), every key of a batch is hashed and its index group
+    // prefetched before the first one is stored.
+    template <std::ranges::random_access_range Keys, std::ranges::random_access_range Values>
+        requires std::constructible_from<Key, const std::ranges::range_value_t<Keys> &> &&
+                 std::constructible_from<Value, const std::ranges::range_value_t<Values> &>
+    void set_many(const Keys &keys, const Values &values) {
+        const size_t count = std::ranges::size(keys);
+        size_t hashes[kBatchSize];
+        for (size_t begin = 0; begin < count; begin += kBatchSize) {
+            const size_t end = std::min(count, begin + kBatchSize);
+            for (size_t i = begin; i < end; ++i) {
+                hashes[i - begin] = hash_(keys[i]);
+                index_.prefetch(hashes[i - begin]);
+            }
+            for (size_t i = begin; i < end; ++i) {
+                set_hashed(hashes[i - begin], keys[i], values[i], default_ttl_);
+            }
+        }
+        notify_evicted(std::exchange(evicted_, nullptr));
+    }
+
+    // Advances the timing wheel to the current time, dropping expired
+    // entries, but visiting at most about `budget` entries. Returns false if
+    // there is more to do.
+    bool expire(size_t budget = SIZE_MAX) { return expire_until(clock_(), budget); }
+
+    template <typename K>
+        requires std::constructible_from<Key, const K &>
+    bool get(const K &key, Value *value) {
+        const Entry *entry = find(hash_(key), key);
+        if (entry == nullptr) {
+            return false;
+        }
+        *value = entry->value;
+        return true;
+    }
+
+    // Zero-copy hit: *value views the stored value instead of copying it. The
+    // view is invalidated by any later non-const call on this cache: set()
+    // may overwrite or evict the entry, and get(), get_many() and expire()
+    // drop expired entries.
+    template <typename K>
+        requires std::constructible_from<Key, const K &> &&
+                 std::convertible_to<const Value &, std::string_view>
+    bool get(const K &key, std::string_view *value) {
+        const Entry *entry = find(hash_(key), key);
+        if (entry == nullptr) {
+            return false;
+        }
+        *value = entry->value;
+        return true;
+    }
+
+    // Read-through get(): on a miss, stores and returns loader(key). See
+    // BasicShardedLruCache for the variant that coalesces concurrent misses.
+    template <typename K, typename Loader>
+        requires std::constructible_from<Key, const K &> &&
+                 std::convertible_to<std::invoke_result_t<Loader &, const K &>, Value>
+    Value get_or_load(const K &key, Loader &&loader) {
+        const size_t hash = hash_(key);
+        if (const Entry *entry = find(hash, key); entry != nullptr) {
+            return entry->value;
+        }
+        Value value = loader(key);
+        set_hashed(hash, key, value, default_ttl_);
+        notify_evicted(std::exchange(evicted_, nullptr));
+        return value;
+    }
+
+    // Batched get(): looks keys[i] up into values[i] and found[i] and returns
+    // the number of hits. All keys of a batch are hashed and their index
+    // groups prefetched before the first one is resolved, so the cache misses
+    // of the probes overlap instead of adding up. Out is Value, or
+    // std::string_view for zero-copy hits as with get().
+    template <std::ranges::random_access_range Keys, typename Out>
+        requires std::constructible_from<Key, const std::ranges::range_value_t<Keys> &>
+    size_t get_many(const Keys &keys, Out *values, bool *found) {
+        const size_t count = std::ranges::size(keys);
+        size_t hashes[kBatchSize];
+        size_t hits = 0;
+        for (size_t begin = 0; begin < count; begin += kBatchSize) {
+            const size_t end = std::min(count, begin + kBatchSize);
+            for (size_t i = begin; i < end; ++i) {
+                hashes[i - begin] = hash_(keys[i]);
+                index_.prefetch(hashes[i - begin]);
+            }
+            for (size_t i = begin; i < end; ++i) {
+                const Entry *entry = find(hashes[i - begin], keys[i]);
+                found[i] = entry != nullptr;
+                if (entry != nullptr) {
+                    values[i] = entry->value;
+                    ++hits;
+                }
+            }
+        }
+        return hits;
+    }
+
+    // StringView does not convert to std::string, so it is unwrapped here.
+    template <std::same_as<StringView> View>
+        requires std::same_as<Key, std::string> && std::same_as<Value, std::string>
+    void set(const View &key, const View &value) {
+        set(std::string_view(key.Data(), key.Size()), std::string_view(value.Data(), value.Size()));
+    }
+
+    template <std::same_as<StringView> View, typename Out>
+        requires std::same_as<Key, std::string>
+    bool get(const View &key, Out *value) {
+        return get(std::string_view(key.Data(), key.Size()), value);
+    }
+
+    // Writes the entries to a snapshot file (see snapshot.h), least recently
+    // used first, replacing `path` atomically. Expired entries are left out
+    // and TTLs are stored as the time left. Returns false on I/O errors or if
+    // a key or value does not fit a record, i.e. takes 4 GiB or more.
+    bool save(const std::string &path) const
+        requires SnapshotField<Key> && SnapshotField<Value>
+    {
+        const std::string temp_path = path + ".tmp";
+        std::FILE *file = std::fopen(temp_path.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        std::setvbuf(file, nullptr, _IOFBF, size_t{1} << 20);
+        const uint64_t now = timers_.size() != 0 ? clock_() : 0;
+        const auto live = [now](const Entry *entry) {
+            return entry->expires_at == 0 || entry->expires_at > now;
+        };
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+        header.version = kSnapshotVersion;
+        header.record_size = sizeof(SnapshotRecord);
+        for (const Entry *entry = lru_.front(); entry != nullptr; entry = entry->next) {
+            header.count += live(entry) ? 1 : 0;
+        }
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        uint64_t offset = 0;
+        for (const Entry *entry = lru_.front(); ok && entry != nullptr; entry = entry->next) {
+            if (!live(entry)) {
+                continue;
+            }
+            const size_t key_size = snapshot_bytes(entry->key).size();
+            const size_t value_size = snapshot_bytes(entry->value).size();
+            // The record stores sizes in 32 bits.
+            if (key_size > UINT32_MAX || value_size > UINT32_MAX) {
+                ok = false;
+                break;
+            }
+            SnapshotRecord record{};
+            record.hash = entry->hash;
+            record.offset = offset;
+            record.key_size = static_cast<uint32_t>(key_size);
+            record.value_size = static_cast<uint32_t>(value_size);
+            record.ttl_ms = entry->expires_at == 0 ? 0 : entry->expires_at - now;
+            offset += record.key_size + record.value_size;
+            ok = std::fwrite(&record, sizeof(record), 1, file) == 1;
+        }
+        for (const Entry *entry = lru_.front(); ok && entry != nullptr; entry = entry->next) {
+            if (!live(entry)) {
+                continue;
+            }
+            const auto key = snapshot_bytes(entry->key);
+            const auto value = snapshot_bytes(entry->value);
+            ok = std::fwrite(key.data(), 1, key.size(), file) == key.size() &&
+                 std::fwrite(value.data(), 1, value.size(), file) == value.size();
+        }
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Fills this cache, which must be empty, from a snapshot written by
+    // save(). The file is mapped rather than read, and the index is rebuilt
+    // from the record table with the stored hashes; keys are rehashed only if
+    // this cache's Hash disagrees with the one that wrote the file. If the
+    // snapshot holds more than fits, its least recently used entries are
+    // dropped. Returns false, leaving the cache empty, if the file is missing
+    // or malformed, e.g. holds a key twice.
+    bool load(const std::string &path)
+        requires SnapshotField<Key> && SnapshotField<Value>
+    {
+        if (!lru_.empty()) {
+            return false;
+        }
+        const MappedFile file(path);
+        const std::string_view bytes = file.bytes();
+        SnapshotHeader header{};
+        if (bytes.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 ||
+            header.version != kSnapshotVersion || header.record_size != sizeof(SnapshotRecord) ||
+            header.count > (bytes.size() - sizeof(header)) / sizeof(SnapshotRecord)) {
+            return false;
+        }
+        const char *records = bytes.data() + sizeof(header);
+        const std::string_view data = bytes.substr(sizeof(header) + header.count * sizeof(SnapshotRecord));
 
-    LruCache(const LruCache &) = delete;
-    ~LruCache() = default;
-    LruCache(LruCache &&) = delete;
-    LruCache &operator=(const LruCache &) = delete;
-    LruCache &operator=(const LruCache &&) = delete;
+        // Without a weigher, entries beyond max_size would only be evicted again.
+        const size_t first = weigher_ ? 0 : header.count - std::min<uint64_t>(header.count, max_size_);
+        index_.reserve(header.count - first);
+        const uint64_t now = clock_();
+        // The wheel of an empty cache holds no timers; this only moves it to
+        // `now`, so that TTLs are scheduled relative to the current time.
+        expire_until(now, SIZE_MAX);
+        bool rehash = false;
+        for (size_t i = first; i < header.count; ++i) {
+            SnapshotRecord record;
+            std::memcpy(&record, records + i * sizeof(record), sizeof(record));
+            if (record.offset > data.size() ||
+                uint64_t{record.key_size} + record.value_size > data.size() - record.offset) {
+                abandon_load();
+                return false;
+            }
+            const auto key_bytes = data.substr(record.offset, record.key_size);
+            const auto value_bytes = data.substr(record.offset + record.key_size, record.value_size);
+            if (!snapshot_fits<Key>(key_bytes) || !snapshot_fits<Value>(value_bytes)) {
+                abandon_load();
+                return false;
+            }
+            const auto key = snapshot_field<Key>(key_bytes);
+            if (i == first) {
+                rehash = hash_of(key) != record.hash;
+            }
+            const size_t hash = rehash ? hash_of(key) : record.hash;
+            // A key stored twice can only come from a corrupt file.
+            if (contains(hash, key)) {
+                abandon_load();
+                return false;
+            }
+            insert(new Entry(hash, key, snapshot_field<Value>(value_bytes)),
+                   record.ttl_ms == 0 ? 0 : now + record.ttl_ms);
+        }
+        notify_evicted(std::exchange(evicted_, nullptr));
+        return true;
+    }
 
-    void set(const std::string &key, const std::string &value);
+    [[nodiscard]] size_t size() const { return index_.size(); }
 
-    bool get(const std::string &key, std::string *value);
+    // Total weight of the stored entries; equals size() without a weigher.
+    [[nodiscard]] size_t weight() const { return weight_; }
+
+    // Safe to call from any thread, also while another one uses the cache.
+    [[nodiscard]] CacheStatsSnapshot stats() const
+        requires Stats::kEnabled
+    {
+        return stats_.snapshot();
+    }
 
 private:
-    std::list<std::pair<std::string, std::string>> lru_;
-    std::unordered_map<std::string,
-                       std::list<std::pair<std::string, std::string>>::iterator>
-        data_;
+    // The sharded cache hashes keys once for shard and index, and hands
+    // evicted entries to the listener after releasing the shard lock.
+    friend class BasicShardedLruCache<Key, Value, Hash, KeyEqual, Stats>;
+
+    // An entry is a single heap node, referenced by index_ and linked into lru_
+    // through prev/next. The key is stored only here, next to its hash, so the
+    // index can erase and rehash without hashing keys again.
+    struct Entry {
+        template <typename K, typename V>
+        Entry(size_t hash, const K &key, V &&value)
+            : hash(hash), key(key), value(std::forward<V>(value)) {}
+
+        size_t hash;
+        Key key;
+        Value value;
+        size_t weight{1};
+        // Zero if the entry never expires.
+        uint64_t expires_at{0};
+        mutable const Entry *prev{nullptr};
+        mutable const Entry *next{nullptr};
+        mutable const Entry *timer_next{nullptr};
+        mutable const Entry **timer_pprev{nullptr};
+    };
+
+    // set() with the hash of `key` already computed.
+    template <typename K, typename V>
+    void set_hashed(size_t hash, const K &key, V &&value, std::chrono::milliseconds ttl) {
+        uint64_t expires_at = 0;
+        if (ttl.count() > 0 || timers_.size() != 0) {
+            const uint64_t now = clock_();
+            expire_until(now, kExpireStepsPerSet);
+            if (ttl.count() > 0) {
+                expires_at = now + static_cast<uint64_t>(ttl.count());
+            }
+        }
+        if (Entry *entry = index_.find(hash, matches(key)); entry != nullptr) {
+            reschedule(entry, expires_at);
+            const size_t old_bytes = bytes_of(*entry);
+            entry->value = std::forward<V>(value);
+            stats_.updated(old_bytes, bytes_of(*entry));
+            const size_t weight = weigh(*entry);
+            weight_ = weight_ - entry->weight + weight;
+            entry->weight = weight;
+            lru_.move_to_back(entry);
+            if (weight > max_size_) {
+                // Could never fit; the stale value must not stay behind either.
+                evict(entry);
+            }
+            evict_until_fits(0);
+            return;
+        }
+        insert(new Entry(hash, key, std::forward<V>(value)), expires_at);
+    }
+
+    // Takes ownership of a new entry whose key is not present yet and makes
+    // it the most recently used one.
+    void insert(Entry *entry, uint64_t expires_at) {
+        entry->weight = weigh(*entry);
+        if (entry->weight > max_size_) {
+            retire(entry);
+            return;
+        }
+        evict_until_fits(entry->weight);
+        weight_ += entry->weight;
+        stats_.inserted(bytes_of(*entry));
+        index_.insert(entry);
+        lru_.push_back(entry);
+        reschedule(entry, expires_at);
+    }
+
+    // hash_ applied to a key, or to what snapshot_field() decoded it to.
+    template <typename K>
+    size_t hash_of(const K &key) const {
+        if constexpr (std::is_invocable_v<const Hash &, const K &>) {
+            return hash_(key);
+        } else {
+            return hash_(Key(key));
+        }
+    }
+
+    // Whether `key`, or what snapshot_field() decoded it to, is stored.
+    template <typename K>
+    bool contains(size_t hash, const K &key) {
+        if constexpr (std::is_invocable_v<const KeyEqual &, const Key &, const K &>) {
+            return index_.find(hash, matches(key)) != nullptr;
+        } else {
+            return index_.find(hash, matches(Key(key))) != nullptr;
+        }
+    }
+
+    template <typename K>
+    auto matches(const K &key) const {
+        return [this, &key](const Entry &entry) { return equal_(entry.key, key); };
+    }
+
+    // Returns the entry of `key` promoted to the most recently used end, or
+    // nullptr on a miss. Expired entries are dropped and count as misses.
+    template <typename K>
+    const Entry *find(size_t hash, const K &key) {
+        const Entry *entry = index_.find(hash, matches(key));
+        if (entry == nullptr) {
+            stats_.miss();
+            return nullptr;
+        }
+        if (entry->expires_at != 0 && entry->expires_at <= clock_()) {
+            stats_.expired();
+            stats_.miss();
+            erase(entry);
+            return nullptr;
+        }
+        stats_.hit();
+        lru_.move_to_back(entry);
+        return entry;
+    }
+
+    void reschedule(Entry *entry, uint64_t expires_at) {
+        timers_.cancel(entry);
+        entry->expires_at = expires_at;
+        if (expires_at != 0) {
+            timers_.schedule(entry);
+        }
+    }
+
+    bool expire_until(uint64_t now, size_t budget) {
+        return timers_.advance(now, budget, [this](const Entry *entry) {
+            stats_.expired();
+            erase(entry);
+        });
+    }
+
+    void erase(const Entry *entry) {
+        unlink(entry);
+        delete entry;
+    }
+
+    // Removes an entry from the cache without destroying it.
+    void unlink(const Entry *entry) {
+        timers_.cancel(entry);
+        lru_.remove(entry);
+        weight_ -= entry->weight;
+        stats_.removed(bytes_of(*entry));
+        index_.erase(entry);
+    }
+
+    void evict(const Entry *entry) {
+        stats_.evicted();
+        unlink(entry);
+        retire(entry);
+    }
+
+    // Destroys an entry that left the cache for lack of room or, with a
+    // listener, queues it on evicted_ through its `next` link.
+    void retire(const Entry *entry) {
+        if (!listener_) {
+            delete entry;
+            return;
+        }
+        entry->next = evicted_;
+        evicted_ = entry;
+    }
+
+    // Hands a queue taken from evicted_ to the listener, oldest entry first,
+    // and destroys its entries. Touches nothing but the queue, so the sharded
+    // cache calls it after releasing the shard lock.
+    void notify_evicted(const Entry *evicted) const {
+        const Entry *oldest = nullptr;
+        while (evicted != nullptr) {
+            const Entry *next = evicted->next;
+            evicted->next = oldest;
+            oldest = evicted;
+            evicted = next;
+        }
+        while (oldest != nullptr) {
+            // Entries are only ever created non-const.
+            auto *entry = const_cast<Entry *>(oldest);
+            oldest = oldest->next;
+            listener_(std::move(entry->key), std::move(entry->value));
+            delete entry;
+        }
+    }
+
+    void clear() {
+        while (!lru_.empty()) {
+            erase(lru_.front());
+        }
+    }
+
+    // Empties the cache after a failed load(). Entries the load evicted are
+    // destroyed without reaching the listener, since the load never happened.
+    void abandon_load() {
+        clear();
+        while (evicted_ != nullptr) {
+            delete std::exchange(evicted_, evicted_->next);
+        }
+    }
+
+    void evict_until_fits(size_t weight) {
+        while (!lru_.empty() && weight_ + weight > max_size_) {
+            evict(lru_.front());
+        }
+    }
+
+    [[nodiscard]] size_t weigh(const Entry &entry) const {
+        return weigher_ ? weigher_(entry.key, entry.value) : 1;
+    }
+
+    [[nodiscard]] size_t bytes_of(const Entry &entry) const {
+        if constexpr (Stats::kEnabled) {
+            return payload_bytes(entry.key) + payload_bytes(entry.value);
+        } else {
+            return 0;
+        }
+    }
+
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] KeyEqual equal_;
+    FlatIndex<Entry> index_;
+    RecencyList<Entry> lru_;
+    TimingWheel<Entry> timers_;
+    Clock clock_{steady_clock_ms};
+    std::chrono::milliseconds default_ttl_{0};
+    Weigher weigher_;
+    EvictionListener listener_;
+    // Evicted entries the listener has yet to see, newest first.
+    const Entry *evicted_{nullptr};
+    size_t weight_{0};
     size_t max_size_{0};
+    [[no_unique_address]] Stats stats_;
 };
-#endif
\ No newline at end of file
+
+// The original string cache. Probing it with a std::string_view, a string
+// literal or a slice of a network buffer never builds a temporary std::string;
+// the repo's StringView is accepted as well.
+using LruCache = BasicLruCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
+
+extern template class BasicLruCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
+#endif
@@ -0,0 +1,56 @@
+#ifndef RECENCY_LIST_H
+
+#define RECENCY_LIST_H
+#include <cstddef>
+
+// Intrusive doubly-linked recency list shared by the cache engines. Node must
+// have `mutable const Node *prev, *next` members; the list never owns nodes,
+// so linking and unlinking never allocate. front() is the least recently used
+// node, back() the most recently used one.
+template <typename Node>
+class RecencyList {
+public:
+    [[nodiscard]] const Node *front() const { return head_; }
+    [[nodiscard]] const Node *back() const { return tail_; }
+    [[nodiscard]] bool empty() const { return head_ == nullptr; }
+    [[nodiscard]] size_t size() const { return size_; }
+
+    void push_back(const Node *node) {
+        node->prev = tail_;
+        node->next = nullptr;
+        if (tail_ != nullptr) {
+            tail_->next = node;
+        } else {
+            head_ = node;
+        }
+        tail_ = node;
+        ++size_;
+    }
+
+    void remove(const Node *node) {
+        if (node->prev != nullptr) {
+            node->prev->next = node->next;
+        } else {
+            head_ = node->next;
+        }
+        if (node->next != nullptr) {
+            node->next->prev = node->prev;
+        } else {
+            tail_ = node->prev;
+        }
+        --size_;
+    }
+
+    void move_to_back(const Node *node) {
+        if (node != tail_) {
+            remove(node);
+            push_back(node);
+        }
+    }
+
+private:
+    const Node *head_{nullptr};
+    const Node *tail_{nullptr};
+    size_t size_{0};
+};
+#endif
@@ -0,0 +1,3 @@
+#include "sharded_lru_cache.h"
+
+template class BasicShardedLruCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
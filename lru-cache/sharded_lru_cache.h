@@ -0,0 +1,345 @@
+#ifndef SHARDED_LRU_CACHE_H
+
+#define SHARDED_LRU_CACHE_H
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cache_stats.h"
+#include "lru_cache.h"
+#include "string_key.h"
+#include "string_view.h"
+
+// Thread-safe BasicLruCache: keys are hashed across independently locked
+// shards, each owning its own recency list and an equal share of the budget.
+// Recency is tracked per shard, so eviction order is only approximately LRU
+// across the whole cache.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, typename Stats = NoCacheStats>
+class BasicShardedLruCache {
+public:
+    using Cache = BasicLruCache<Key, Value, Hash, KeyEqual, Stats>;
+    using Weigher = typename Cache::Weigher;
+    using Clock = typename Cache::Clock;
+    using EvictionListener = typename Cache::EvictionListener;
+
+    static constexpr size_t kDefaultShardCount = 16;
+
+    explicit BasicShardedLruCache(size_t max_size, size_t shard_count = kDefaultShardCount)
+        : BasicShardedLruCache(max_size, Weigher{}, shard_count) {}
+
+    // Weighted mode, see BasicLruCache. The budget is split exactly: each
+    // shard gets max_weight / shard_count and the first max_weight %
+    // shard_count shards one unit more. There are never more shards than
+    // units of budget, so that no shard is left with nothing.
+    BasicShardedLruCache(size_t max_weight, const Weigher &weigher,
+                         size_t shard_count = kDefaultShardCount) {
+        shard_count = std::max<size_t>(std::min(shard_count, max_weight), 1);
+        shards_.reserve(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            const size_t shard_size = max_weight / shard_count + (i < max_weight % shard_count ? 1 : 0);
+            shards_.push_back(std::make_unique<Shard>(shard_size, weigher));
+        }
+    }
+
+    BasicShardedLruCache(const BasicShardedLruCache &) = delete;
+    ~BasicShardedLruCache() = default;
+    BasicShardedLruCache(BasicShardedLruCache &&) = delete;
+    BasicShardedLruCache &operator=(const BasicShardedLruCache &) = delete;
+    BasicShardedLruCache &operator=(const BasicShardedLruCache &&) = delete;
+
+    template <typename K, typename V>
+        requires std::constructible_from<Key, const K &> && std::constructible_from<Value, V &&>
+    void set(const K &key, V &&value) {
+        store(key, std::forward<V>(value), nullptr);
+    }
+
+    template <typename K, typename V>
+        requires std::constructible_from<Key, const K &> && std::constructible_from<Value, V &&>
+    void set(const K &key, V &&value, std::chrono::milliseconds ttl) {
+        store(key, std::forward<V>(value), &ttl);
+    }
+
+    // Batched set(), see BasicLruCache. Keys are grouped by shard, so each
+    // shard touched by the batch is locked once.
+    template <std::ranges::random_access_range Keys, std::ranges::random_access_range Values>
+        requires std::constructible_from<Key, const std::ranges::range_value_t<Keys> &> &&
+                 std::constructible_from<Value, const std::ranges::range_value_t<Values> &>
+    void set_many(const Keys &keys, const Values &values) {
+        for_each_shard_batch(keys, [&](Cache &cache, size_t hash, size_t i) {
+            cache.set_hashed(hash, keys[i], values[i], cache.default_ttl_);
+        });
+    }
+
+    // See BasicLruCache; applied to every shard.
+    void set_default_ttl(std::chrono::milliseconds ttl) {
+        for (auto &shard : shards_) {
+            const std::lock_guard lock(shard->mutex);
+            shard->cache.set_default_ttl(ttl);
+        }
+    }
+
+    // See BasicLruCache. The listener runs after the shard lock is released,
+    // so a slow one only delays the thread whose set() evicted; it may be
+    // called from several threads at once. Set it before sharing the cache.
+    void set_eviction_listener(const EvictionListener &listener) {
+        for (auto &shard : shards_) {
+            const std::lock_guard lock(shard->mutex);
+            shard->cache.set_eviction_listener(listener);
+        }
+    }
+
+    // The clock is called with a shard lock held and must be thread-safe.
+    void set_clock(const Clock &clock) {
+        for (auto &shard : shards_) {
+            const std::lock_guard lock(shard->mutex);
+            shard->cache.set_clock(clock);
+        }
+    }
+
+    // Drops expired entries, locking one shard at a time with `budget` per
+    // shard. Returns false if some shard has more to do.
+    bool expire(size_t budget = SIZE_MAX) {
+        bool done = true;
+        for (auto &shard : shards_) {
+            const std::lock_guard lock(shard->mutex);
+            done = shard->cache.expire(budget) && done;
+        }
+        return done;
+    }
+
+    template <typename K>
+        requires std::constructible_from<Key, const K &>
+    bool get(const K &key, Value *value) {
+        auto &shard = shard_for(key);
+        const std::lock_guard lock(shard.mutex);
+        return shard.cache.get(key, value);
+    }
+
+    // Batched get(), see BasicLruCache. Keys are grouped by shard, so each
+    // shard touched by the batch is locked once, and its probes are
+    // prefetched together under that lock. Out is Value only: views would
+    // not survive the shard lock.
+    template <std::ranges::random_access_range Keys>
+        requires std::constructible_from<Key, const std::ranges::range_value_t<Keys> &>
+    size_t get_many(const Keys &keys, Value *values, bool *found) {
+        size_t hits = 0;
+        for_each_shard_batch(keys, [&](Cache &cache, size_t hash, size_t i) {
+            const auto *entry = cache.find(hash, keys[i]);
+            found[i] = entry != nullptr;
+            if (entry != nullptr) {
+                values[i] = entry->value;
+                ++hits;
+            }
+        });
+        return hits;
+    }
+
+    // Read-through get(): on a miss, calls loader(key), stores the Value it
+    // returns and returns it. Concurrent misses on the same key are coalesced:
+    // only the first one calls the loader and the others wait for its result,
+    // so a hot key that drops out reaches the backend once. The loader runs
+    // without the shard lock. If a set() stores the key meanwhile, its value
+    // is newer than the loaded one, so that value is kept and returned
+    // instead. If the loader throws, the waiters get the exception as well,
+    // nothing is stored and the next call loads again.
+    template <typename K, typename Loader>
+        requires std::constructible_from<Key, const K &> &&
+                 std::convertible_to<std::invoke_result_t<Loader &, const K &>, Value>
+    Value get_or_load(const K &key, Loader &&loader) {
+        const size_t hash = Hash{}(key);
+        auto &shard = *shards_[shard_index(hash)];
+        std::unique_lock lock(shard.mutex);
+        if (const auto *entry = shard.cache.find(hash, key); entry != nullptr) {
+            return entry->value;
+        }
+        Key owned_key(key);
+        if (auto it = shard.loading.find(owned_key); it != shard.loading.end()) {
+            const auto pending = it->second;
+            lock.unlock();
+            return pending.get();
+        }
+        std::promise<Value> promise;
+        shard.loading.emplace(owned_key, promise.get_future().share());
+        lock.unlock();
+
+        std::optional<Value> value;
+        try {
+            value.emplace(loader(key));
+        } catch (...) {
+            lock.lock();
+            shard.loading.erase(owned_key);
+            lock.unlock();
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        lock.lock();
+        shard.loading.erase(owned_key);
+        if (const auto *entry = shard.cache.find(hash, key); entry != nullptr) {
+            *value = entry->value;
+            lock.unlock();
+            promise.set_value(*value);
+            return std::move(*value);
+        }
+        shard.cache.set_hashed(hash, key, *value, shard.cache.default_ttl_);
+        const auto *evicted = std::exchange(shard.cache.evicted_, nullptr);
+        lock.unlock();
+        shard.cache.notify_evicted(evicted);
+        promise.set_value(*value);
+        return std::move(*value);
+    }
+
+    // Zero-copy hit: calls reader(std::string_view) on the stored value while
+    // the shard lock is held. The view must not escape the call, since other
+    // threads may overwrite or evict the entry as soon as the lock is released.
+    template <typename K, typename Reader>
+        requires std::constructible_from<Key, const K &>
+    bool visit(const K &key, Reader &&reader) {
+        auto &shard = shard_for(key);
+        const std::lock_guard lock(shard.mutex);
+        std::string_view value;
+        if (!shard.cache.get(key, &value)) {
+            return false;
+        }
+        reader(value);
+        return true;
+    }
+
+    template <std::same_as<StringView> View>
+        requires std::same_as<Key, std::string> && std::same_as<Value, std::string>
+    void set(const View &key, const View &value) {
+        set(std::string_view(key.Data(), key.Size()), std::string_view(value.Data(), value.Size()));
+    }
+
+    template <std::same_as<StringView> View, typename Out>
+        requires std::same_as<Key, std::string>
+    bool get(const View &key, Out *value) {
+        return get(std::string_view(key.Data(), key.Size()), value);
+    }
+
+    [[nodiscard]] size_t shard_count() const { return shards_.size(); }
+
+    // Entries over all shards, locking one shard at a time.
+    [[nodiscard]] size_t size() {
+        size_t total = 0;
+        for (auto &shard : shards_) {
+            const std::lock_guard lock(shard->mutex);
+            total += shard->cache.size();
+        }
+        return total;
+    }
+
+    // Sum over the shards, read without taking their locks; shards are not
+    // sampled at the same instant.
+    [[nodiscard]] CacheStatsSnapshot stats() const
+        requires Stats::kEnabled
+    {
+        CacheStatsSnapshot total;
+        for (const auto &shard : shards_) {
+            total += shard->cache.stats();
+        }
+        return total;
+    }
+
+private:
+    // Each shard sits on its own cache line so that neighbouring mutexes do
+    // not bounce between cores.
+    struct alignas(64) Shard {
+        Shard(size_t max_size, const Weigher &weigher) : cache(max_size, weigher) {}
+
+        std::mutex mutex;
+        Cache cache;
+        // Keys get_or_load() is loading, with the result their waiters share.
+        std::unordered_map<Key, std::shared_future<Value>, Hash, KeyEqual> loading;
+    };
+
+    // set() with `ttl`, or with the shard's default TTL if it is nullptr.
+    template <typename K, typename V>
+    void store(const K &key, V &&value, const std::chrono::milliseconds *ttl) {
+        const size_t hash = Hash{}(key);
+        auto &shard = *shards_[shard_index(hash)];
+        std::unique_lock lock(shard.mutex);
+        shard.cache.set_hashed(hash, key, std::forward<V>(value),
+                               ttl != nullptr ? *ttl : shard.cache.default_ttl_);
+        const auto *evicted = std::exchange(shard.cache.evicted_, nullptr);
+        lock.unlock();
+        shard.cache.notify_evicted(evicted);
+    }
+
+    // Keys that get_many() and set_many() sort by shard at a time.
+    static constexpr size_t kShardBatchSize = 256;
+
+    template <typename K>
+    Shard &shard_for(const K &key) {
+        return *shards_[shard_index(Hash{}(key))];
+    }
+
+    [[nodiscard]] size_t shard_index(size_t hash) const {
+        // The shard's own index uses the same hash; mixing keeps the shard
+        // index independent of the bucket index inside the shard.
+        const uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL;
+        return (mixed >> 32) % shards_.size();
+    }
+
+    // Hashes the keys once and sorts their positions by shard. Then, for every
+    // shard in turn and with its lock held, prefetches the index groups of its
+    // keys and calls resolve(cache, hash, i) for each of them in input order.
+    // Entries evicted meanwhile go to the listener once the lock is released.
+    template <typename Keys, typename Resolve>
+    void for_each_shard_batch(const Keys &keys, Resolve &&resolve) {
+        const size_t total = std::ranges::size(keys);
+        size_t hashes[kShardBatchSize];
+        uint32_t shard_of[kShardBatchSize];
+        uint32_t order[kShardBatchSize];
+        for (size_t begin = 0; begin < total; begin += kShardBatchSize) {
+            const size_t count = std::min(total - begin, kShardBatchSize);
+            for (size_t i = 0; i < count; ++i) {
+                hashes[i] = Hash{}(keys[begin + i]);
+                shard_of[i] = static_cast<uint32_t>(shard_index(hashes[i]));
+                order[i] = static_cast<uint32_t>(i);
+            }
+            std::sort(order, order + count, [&](uint32_t a, uint32_t b) {
+                return shard_of[a] != shard_of[b] ? shard_of[a] < shard_of[b] : a < b;
+            });
+            for (size_t run = 0; run < count;) {
+                size_t run_end = run + 1;
+                while (run_end < count && shard_of[order[run_end]] == shard_of[order[run]]) {
+                    ++run_end;
+                }
+                auto &shard = *shards_[shard_of[order[run]]];
+                std::unique_lock lock(shard.mutex);
+                for (size_t i = run; i < run_end; ++i) {
+                    shard.cache.index_.prefetch(hashes[order[i]]);
+                }
+                for (size_t i = run; i < run_end; ++i) {
+                    resolve(shard.cache, hashes[order[i]], begin + order[i]);
+                }
+                const auto *evicted = std::exchange(shard.cache.evicted_, nullptr);
+                lock.unlock();
+                shard.cache.notify_evicted(evicted);
+                run = run_end;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+using ShardedLruCache = BasicShardedLruCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
+
+extern template class BasicShardedLruCache<std::string, std::string, StringKeyHash, StringKeyEqual>;
+#endif
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arc_cache.h"
+#include "clock_cache.h"
+#include "concurrent_lru_cache.h"
+#include "lru_cache.h"
+#include "sharded_lru_cache.h"
+#include "tiny_lfu_cache.h"
+#include "trace.h"
+
+// Trace-replay cache simulator. Replays a recorded key trace or a synthetic
+// one read-through (get(), and set() on a miss) against one or more engines
+// at several capacities, and prints hit ratio, throughput and latency
+// percentiles per run. Meant for sizing caches and for spotting performance
+// regressions; build with -DCMAKE_BUILD_TYPE=Release.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr char kUsage[] =
+    "usage: lru_cache_sim [options]\n"
+    "  --trace FILE          replay FILE instead of a synthetic trace\n"
+    "  --format text|binary  text: one key per line (default);\n"
+    "                        binary: native-endian uint64 key ids\n"
+    "  --generator zipf|uniform|scan  synthetic trace (default zipf)\n"
+    "  --keys N              key space of the generator (default 1000000)\n"
+    "  --ops N               accesses generated (default 10000000)\n"
+    "  --skew S              Zipf exponent (default 0.99)\n"
+    "  --capacities A,B,...  cache sizes in entries (default 1000,10000,100000)\n"
+    "  --engines A,B,...     lru, arc, tinylfu, clock, sharded, concurrent (default lru)\n"
+    "  --value-size B        bytes stored per entry (default 100)\n";
+
+struct Options {
+    const char *trace = nullptr;
+    bool binary = false;
+    std::string generator = "zipf";
+    size_t keys = 1'000'000;
+    size_t ops = 10'000'000;
+    double skew = 0.99;
+    std::vector<size_t> capacities = {1'000, 10'000, 100'000};
+    std::vector<std::string> engines = {"lru"};
+    size_t value_size = 100;
+};
+
+struct RunResult {
+    double hit_ratio;
+    double mops;
+    double p50_ns;
+    double p99_ns;
+    double p999_ns;
+};
+
+std::vector<std::string> SplitList(std::string_view list) {
+    std::vector<std::string> items;
+    while (!list.empty()) {
+        const size_t comma = std::min(list.find(','), list.size());
+        if (comma != 0) {
+            items.emplace_back(list.substr(0, comma));
+        }
+        list.remove_prefix(std::min(comma + 1, list.size()));
+    }
+    return items;
+}
+
+// Returns false on a malformed command line.
+bool ParseOptions(int argc, char **argv, Options *options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view flag = argv[i];
+        if (i + 1 == argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        if (flag == "--trace") {
+            options->trace = value;
+        } else if (flag == "--format") {
+            if (std::strcmp(value, "text") != 0 && std::strcmp(value, "binary") != 0) {
+                return false;
+            }
+            options->binary = std::strcmp(value, "binary") == 0;
+        } else if (flag == "--generator") {
+            options->generator = value;
+            if (options->generator != "zipf" && options->generator != "uniform" &&
+                options->generator != "scan") {
+                return false;
+            }
+        } else if (flag == "--keys") {
+            options->keys = std::strtoull(value, nullptr, 10);
+        } else if (flag == "--ops") {
+            options->ops = std::strtoull(value, nullptr, 10);
+        } else if (flag == "--skew") {
+            options->skew = std::strtod(value, nullptr);
+        } else if (flag == "--capacities") {
+            options->capacities.clear();
+            for (const auto &capacity : SplitList(value)) {
+                options->capacities.push_back(std::strtoull(capacity.c_str(), nullptr, 10));
+            }
+        } else if (flag == "--engines") {
+            options->engines = SplitList(value);
+        } else if (flag == "--value-size") {
+            options->value_size = std::strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return options->keys != 0 && !options->capacities.empty() && !options->engines.empty();
+}
+
+std::vector<std::string> LoadTrace(const Options &options) {
+    if (options.trace != nullptr) {
+        return options.binary ? ReadBinaryTrace(options.trace) : ReadTextTrace(options.trace);
+    }
+    if (options.generator == "zipf") {
+        return MakeZipfKeys(options.ops, options.keys, options.skew, 42);
+    }
+    if (options.generator == "uniform") {
+        return MakeUniformKeys(options.ops, options.keys, 42);
+    }
+    return MakeScanKeys(options.ops, options.keys);
+}
+
+double Percentile(std::vector<uint32_t> &nanos, double fraction) {
+    const auto rank = static_cast<size_t>(fraction * static_cast<double>(nanos.size() - 1));
+    std::nth_element(nanos.begin(), nanos.begin() + static_cast<std::ptrdiff_t>(rank), nanos.end());
+    return nanos[rank];
+}
+
+// Two passes over the trace, each on a fresh cache: an untimed one for hit
+// ratio and throughput, and one timing every access for the percentiles, so
+// that reading the clock does not count against throughput.
+template <typename Cache>
+RunResult Replay(size_t capacity, const std::vector<std::string> &trace, const std::string &value) {
+    RunResult result{};
+    {
+        Cache cache(capacity);
+        std::string found;
+        size_t hits = 0;
+        const auto start = Clock::now();
+        for (const auto &key : trace) {
+            if (cache.get(key, &found)) {
+                ++hits;
+            } else {
+                cache.set(key, value);
+            }
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        result.hit_ratio = 100.0 * static_cast<double>(hits) / static_cast<double>(trace.size());
+        result.mops = static_cast<double>(trace.size()) / seconds / 1e6;
+    }
+
+    Cache cache(capacity);
+    std::string found;
+    std::vector<uint32_t> nanos;
+    nanos.reserve(trace.size());
+    for (const auto &key : trace) {
+        const auto start = Clock::now();
+        if (!cache.get(key, &found)) {
+            cache.set(key, value);
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        nanos.push_back(static_cast<uint32_t>(std::min<int64_t>(elapsed.count(), UINT32_MAX)));
+    }
+    result.p50_ns = Percentile(nanos, 0.5);
+    result.p99_ns = Percentile(nanos, 0.99);
+    result.p999_ns = Percentile(nanos, 0.999);
+    return result;
+}
+
+struct Engine {
+    std::string_view name;
+    RunResult (*replay)(size_t capacity, const std::vector<std::string> &trace,
+                        const std::string &value);
+};
+
+constexpr Engine kEngines[] = {
+    {"lru", Replay<LruCache>},
+    {"arc", Replay<ArcCache>},
+    {"tinylfu", Replay<TinyLfuCache>},
+    {"clock", Replay<ClockCache>},
+    {"sharded", Replay<ShardedLruCache>},
+    {"concurrent", Replay<ConcurrentLruCache>},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::fputs(kUsage, stderr);
+        return 2;
+    }
+    std::vector<const Engine *> engines;
+    for (const auto &name : options.engines) {
+        const auto *engine = std::find_if(std::begin(kEngines), std::end(kEngines),
+                                          [&](const Engine &engine) { return engine.name == name; });
+        if (engine == std::end(kEngines)) {
+            std::fprintf(stderr, "unknown engine %s\n%s", name.c_str(), kUsage);
+            return 2;
+        }
+        engines.push_back(engine);
+    }
+    const auto trace = LoadTrace(options);
+    if (trace.empty()) {
+        std::fprintf(stderr, "no accesses: cannot read %s\n",
+                     options.trace != nullptr ? options.trace : options.generator.c_str());
+        return 1;
+    }
+
+    const std::string value(options.value_size, 'v');
+    std::printf("%zu accesses from %s\n", trace.size(),
+                options.trace != nullptr ? options.trace : options.generator.c_str());
+    std::printf("%12s %10s %8s %10s %10s %10s %10s\n", "engine", "capacity", "hit%", "Mop/s",
+                "p50 ns", "p99 ns", "p999 ns");
+    for (size_t capacity : options.capacities) {
+        for (const auto *engine : engines) {
+            const auto result = engine->replay(capacity, trace, value);
+            std::printf("%12s %10zu %8.2f %10.2f %10.0f %10.0f %10.0f\n", engine->name.data(),
+                        capacity, result.hit_ratio, result.mops, result.p50_ns, result.p99_ns,
+                        result.p999_ns);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "slab_allocator.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace {
+
+constexpr size_t kMinChunkSize = 64;
+constexpr size_t kPageSize = 4096;
+
+size_t RoundUp(size_t size, size_t alignment) { return (size + alignment - 1) / alignment * alignment; }
+
+void *Map(size_t size) {
+    void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    return data;
+}
+
+}  // namespace
+
+SlabAllocator::SlabAllocator() {
+    // Classes stop at a quarter slab, so a slab always holds a few chunks.
+    for (size_t size = kMinChunkSize; size <= (kSlabSize - kHeaderSize) / 4;
+         size = RoundUp(size + size / 4, 16)) {
+        classes_.push_back({size});
+    }
+}
+
+SlabAllocator::~SlabAllocator() {
+    for (auto &size_class : classes_) {
+        while (size_class.partial != nullptr) {
+            Slab *slab = size_class.partial;
+            unlink(slab);
+            unmap_slab(slab);
+        }
+    }
+    if (spare_ != nullptr) {
+        unmap_slab(spare_);
+    }
+}
+
+void *SlabAllocator::allocate(size_t size) {
+    const size_t size_class = class_of(size);
+    if (size_class == classes_.size()) {
+        const size_t mapped = RoundUp(size, kPageSize);
+        mapped_bytes_ += mapped;
+        return Map(mapped);
+    }
+    SizeClass &chunks = classes_[size_class];
+    Slab *slab = chunks.partial;
+    if (slab == nullptr) {
+        slab = std::exchange(spare_, nullptr);
+        if (slab == nullptr) {
+            slab = map_slab();
+        }
+        slab->unused = reinterpret_cast<char *>(slab) + kHeaderSize;
+        slab->size_class = static_cast<uint32_t>(size_class);
+        link(slab);
+    }
+    void *chunk = slab->free;
+    if (chunk != nullptr) {
+        slab->free = *static_cast<void **>(chunk);
+    } else {
+        chunk = slab->unused;
+        slab->unused += chunks.chunk_size;
+    }
+    ++slab->live;
+    if (slab->free == nullptr &&
+        slab->unused + chunks.chunk_size > reinterpret_cast<char *>(slab) + kSlabSize) {
+        unlink(slab);
+    }
+    return chunk;
+}
+
+void SlabAllocator::deallocate(void *chunk, size_t size) {
+    const size_t size_class = class_of(size);
+    if (size_class == classes_.size()) {
+        const size_t mapped = RoundUp(size, kPageSize);
+        ::munmap(chunk, mapped);
+        mapped_bytes_ -= mapped;
+        return;
+    }
+    SizeClass &chunks = classes_[size_class];
+    auto *slab = reinterpret_cast<Slab *>(reinterpret_cast<uintptr_t>(chunk) & ~(kSlabSize - 1));
+    const bool was_full =
+        slab->free == nullptr &&
+        slab->unused + chunks.chunk_size > reinterpret_cast<char *>(slab) + kSlabSize;
+    *static_cast<void **>(chunk) = slab->free;
+    slab->free = chunk;
+    if (was_full) {
+        link(slab);
+    }
+    --slab->live;
+    if (chunks.chunk_size > kPageSize && slab->live != 0) {
+        // Chunks of a class are freed in no particular order, so a slab can
+        // sit mostly free for a long time. Once a quarter of it is free, the
+        // pages of its free chunks go back to the kernel; in a fuller slab
+        // they are likely to be reused soon and are kept, as refaulting them
+        // is costly.
+        const size_t sparse = (kSlabSize - kHeaderSize) / chunks.chunk_size * 3 / 4;
+        if (slab->live + 1 == sparse) {
+            for (void *free = slab->free; free != nullptr; free = *static_cast<void **>(free)) {
+                release_pages(free, chunks.chunk_size);
+            }
+        } else if (slab->live + 1 < sparse) {
+            release_pages(chunk, chunks.chunk_size);
+        }
+    }
+    if (slab->live == 0) {
+        unlink(slab);
+        if (spare_ == nullptr) {
+            // Starts over as a fresh slab of whichever class needs one next.
+            slab->free = nullptr;
+            spare_ = slab;
+        } else {
+            unmap_slab(slab);
+        }
+    }
+}
+
+size_t SlabAllocator::chunk_size(size_t size) const {
+    const size_t size_class = class_of(size);
+    return size_class == classes_.size() ? RoundUp(size, kPageSize)
+                                         : classes_[size_class].chunk_size;
+}
+
+size_t SlabAllocator::class_of(size_t size) const {
+    return std::lower_bound(classes_.begin(), classes_.end(), size,
+                            [](const SizeClass &size_class, size_t size) {
+                                return size_class.chunk_size < size;
+                            }) -
+           classes_.begin();
+}
+
+SlabAllocator::Slab *SlabAllocator::map_slab() {
+    // Map twice the size and trim both ends to get an aligned slab.
+    auto *data = static_cast<char *>(Map(2 * kSlabSize));
+    auto *aligned = reinterpret_cast<char *>(
+        RoundUp(reinterpret_cast<uintptr_t>(data), kSlabSize));
+    if (aligned != data) {
+        ::munmap(data, aligned - data);
+    }
+    ::munmap(aligned + kSlabSize, data + kSlabSize - aligned);
+    mapped_bytes_ += kSlabSize;
+
+    return new (aligned) Slab;
+}
+
+void SlabAllocator::release_pages(void *chunk, size_t chunk_size) {
+    // The first page keeps the free-list link.
+    const auto start = reinterpret_cast<uintptr_t>(chunk);
+    const uintptr_t begin = RoundUp(start + sizeof(void *), kPageSize);
+    const uintptr_t end = (start + chunk_size) & ~(kPageSize - 1);
+    if (begin < end) {
+        ::madvise(reinterpret_cast<void *>(begin), end - begin, MADV_DONTNEED);
+    }
+}
+
+void SlabAllocator::unmap_slab(Slab *slab) {
+    ::munmap(slab, kSlabSize);
+    mapped_bytes_ -= kSlabSize;
+}
+
+void SlabAllocator::link(Slab *slab) {
+    SizeClass &chunks = classes_[slab->size_class];
+    slab->prev = nullptr;
+    slab->next = chunks.partial;
+    if (chunks.partial != nullptr) {
+        chunks.partial->prev = slab;
+    }
+    chunks.partial = slab;
+}
+
+void SlabAllocator::unlink(Slab *slab) {
+    SizeClass &chunks = classes_[slab->size_class];
+    if (slab->prev != nullptr) {
+        slab->prev->next = slab->next;
+    } else {
+        chunks.partial = slab->next;
+    }
+    if (slab->next != nullptr) {
+        slab->next->prev = slab->prev;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef SLAB_ALLOCATOR_H
+
+#define SLAB_ALLOCATOR_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Size-classed slab allocator for variable-length cache entries. Chunk sizes
+// grow by about 1.25x per class, so a chunk wastes at most a fifth of itself.
+// Each class carves its chunks out of 1 MiB slabs mapped straight from the
+// kernel, bypassing malloc. A slab whose last chunk is freed goes back to the
+// kernel (one empty slab is kept to absorb churn), so the memory mapped follows
+// the bytes in use instead of its historical peak. A slab of chunks larger than
+// a page that is less than three quarters used also hands the pages of its free
+// chunks back with madvise(). Chunks too big for the largest class get a
+// mapping of their own.
+//
+// deallocate() must be passed the size given to allocate(). Every chunk must
+// be deallocated before the allocator is destroyed.
+class SlabAllocator {
+public:
+    static constexpr size_t kSlabSize = size_t{1} << 20;
+
+    SlabAllocator();
+
+    SlabAllocator(const SlabAllocator &) = delete;
+    SlabAllocator(SlabAllocator &&) = delete;
+    SlabAllocator &operator=(const SlabAllocator &) = delete;
+    SlabAllocator &operator=(SlabAllocator &&) = delete;
+    ~SlabAllocator();
+
+    // 16-byte aligned; throws std::bad_alloc if the kernel refuses a mapping.
+    void *allocate(size_t size);
+    void deallocate(void *chunk, size_t size);
+
+    // Bytes taken by the chunk allocate(size) returns.
+    [[nodiscard]] size_t chunk_size(size_t size) const;
+
+    // Bytes currently mapped for slabs and large chunks.
+    [[nodiscard]] size_t mapped_bytes() const { return mapped_bytes_; }
+
+private:
+    // Header at the start of every slab, which is aligned to kSlabSize so
+    // that a chunk finds its slab by masking its address.
+    struct Slab {
+        // Links among the slabs of the class that have a free chunk.
+        Slab *prev{nullptr};
+        Slab *next{nullptr};
+        // Chunks freed since the slab was carved; linked through their first bytes.
+        void *free{nullptr};
+        // Start of the part never handed out, carved lazily so that untouched
+        // chunks stay unbacked by memory.
+        char *unused{nullptr};
+        uint32_t live{0};
+        uint32_t size_class{0};
+    };
+
+    struct SizeClass {
+        size_t chunk_size{0};
+        Slab *partial{nullptr};
+    };
+
+    static constexpr size_t kHeaderSize = 64;
+
+    [[nodiscard]] size_t class_of(size_t size) const;
+    Slab *map_slab();
+    static void release_pages(void *chunk, size_t chunk_size);
+    void unmap_slab(Slab *slab);
+    void link(Slab *slab);
+    void unlink(Slab *slab);
+
+    std::vector<SizeClass> classes_;
+    // Empty slab kept mapped for the next class that needs one.
+    Slab *spare_{nullptr};
+    size_t mapped_bytes_{0};
+};
+#endif
@@ -0,0 +1,88 @@
+#include "slab_lru_cache.h"
+
+#include <cstring>
+#include <new>
+
+#include "string_key.h"
+
+SlabLruCache::SlabLruCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+SlabLruCache::~SlabLruCache() {
+    while (!lru_.empty()) {
+        erase(lru_.front());
+    }
+}
+
+void SlabLruCache::set(std::string_view key, std::string_view value) {
+    const size_t hash = StringKeyHash{}(key);
+    const size_t bytes = sizeof(Entry) + key.size() + value.size();
+    const size_t charge = slabs_.chunk_size(bytes);
+    const Entry *old = index_.find(hash, [key](const Entry &entry) { return entry.key() == key; });
+    if (old != nullptr && charge == slabs_.chunk_size(old->bytes())) {
+        // Same chunk size: overwrite the value in place. `value` may view the
+        // stored one, e.g. a slice of it, so the ranges can overlap.
+        auto *entry = const_cast<Entry *>(old);
+        std::memmove(reinterpret_cast<char *>(entry + 1) + entry->key_size, value.data(),
+                     value.size());
+        entry->value_size = static_cast<uint32_t>(value.size());
+        lru_.move_to_back(entry);
+        return;
+    }
+    if (charge > max_bytes_) {
+        if (old != nullptr) {
+            erase(old);
+        }
+        return;
+    }
+
+    // The new entry is filled in before the old one and any evicted ones are
+    // freed, since `value` may view one of their chunks.
+    auto *entry = new (slabs_.allocate(bytes)) Entry(hash, key.size(), value.size());
+    auto *data = reinterpret_cast<char *>(entry + 1);
+    std::memcpy(data, key.data(), key.size());
+    std::memcpy(data + key.size(), value.data(), value.size());
+    if (old != nullptr) {
+        erase(old);
+    }
+    while (weight_ + charge > max_bytes_) {
+        erase(lru_.front());
+    }
+    weight_ += charge;
+    index_.insert(entry);
+    lru_.push_back(entry);
+}
+
+bool SlabLruCache::get(std::string_view key, std::string *value) {
+    const Entry *entry = find(key);
+    if (entry == nullptr) {
+        return false;
+    }
+    value->assign(entry->value());
+    return true;
+}
+
+bool SlabLruCache::get(std::string_view key, std::string_view *value) {
+    const Entry *entry = find(key);
+    if (entry == nullptr) {
+        return false;
+    }
+    *value = entry->value();
+    return true;
+}
+
+const SlabLruCache::Entry *SlabLruCache::find(std::string_view key) {
+    const Entry *entry = index_.find(StringKeyHash{}(key),
+                                     [key](const Entry &entry) { return entry.key() == key; });
+    if (entry != nullptr) {
+        lru_.move_to_back(entry);
+    }
+    return entry;
+}
+
+void SlabLruCache::erase(const Entry *entry) {
+    const size_t bytes = entry->bytes();
+    weight_ -= slabs_.chunk_size(bytes);
+    index_.erase(entry);
+    lru_.remove(entry);
+    slabs_.deallocate(const_cast<Entry *>(entry), bytes);
+}
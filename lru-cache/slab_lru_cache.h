@@ -0,0 +1,76 @@
+#ifndef SLAB_LRU_CACHE_H
+
+#define SLAB_LRU_CACHE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "flat_index.h"
+#include "recency_list.h"
+#include "slab_allocator.h"
+
+// LruCache with a byte budget whose entries live in slabs owned by the cache
+// instead of on the malloc heap. Each entry is one SlabAllocator chunk holding
+// its header, key bytes and value bytes; the budget is charged the full chunk
+// size, and evicting an entry returns its chunk to its slab. Under churn of
+// varying value sizes the memory mapped thus stays near max_bytes, where
+// separately malloc'd strings fragment the heap and let RSS drift upwards.
+class SlabLruCache {
+public:
+    explicit SlabLruCache(size_t max_bytes);
+
+    SlabLruCache(const SlabLruCache &) = delete;
+    ~SlabLruCache();
+    SlabLruCache(SlabLruCache &&) = delete;
+    SlabLruCache &operator=(const SlabLruCache &) = delete;
+    SlabLruCache &operator=(const SlabLruCache &&) = delete;
+
+    // An entry whose chunk exceeds max_bytes is not stored, and drops the
+    // previous value of its key.
+    void set(std::string_view key, std::string_view value);
+
+    bool get(std::string_view key, std::string *value);
+
+    // The view stays valid until the next set().
+    bool get(std::string_view key, std::string_view *value);
+
+    [[nodiscard]] size_t size() const { return index_.size(); }
+    // Chunk bytes charged to the budget.
+    [[nodiscard]] size_t weight() const { return weight_; }
+    // Bytes mapped by the slab allocator, i.e. what the entries cost in memory.
+    [[nodiscard]] size_t mapped_bytes() const { return slabs_.mapped_bytes(); }
+
+private:
+    // Followed in the same chunk by key_size key bytes and value_size value bytes.
+    struct Entry {
+        Entry(size_t hash, size_t key_size, size_t value_size)
+            : hash(hash),
+              key_size(static_cast<uint32_t>(key_size)),
+              value_size(static_cast<uint32_t>(value_size)) {}
+
+        size_t hash;
+        mutable const Entry *prev{nullptr};
+        mutable const Entry *next{nullptr};
+        uint32_t key_size;
+        uint32_t value_size;
+
+        [[nodiscard]] std::string_view key() const {
+            return {reinterpret_cast<const char *>(this + 1), key_size};
+        }
+        [[nodiscard]] std::string_view value() const {
+            return {reinterpret_cast<const char *>(this + 1) + key_size, value_size};
+        }
+        [[nodiscard]] size_t bytes() const { return sizeof(Entry) + key_size + value_size; }
+    };
+
+    const Entry *find(std::string_view key);
+    void erase(const Entry *entry);
+
+    FlatIndex<Entry> index_;
+    RecencyList<Entry> lru_;
+    SlabAllocator slabs_;
+    size_t weight_{0};
+    size_t max_bytes_;
+};
+#endif
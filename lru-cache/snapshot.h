@@ -0,0 +1,119 @@
+#ifndef SNAPSHOT_H
+
+#define SNAPSHOT_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// File layout of a cache snapshot:
+//
+//   SnapshotHeader | SnapshotRecord[count] | key and value bytes
+//
+// Records have a fixed size and are ordered from the least to the most
+// recently used entry. Each one carries the hash of its key, so a loader can
+// rebuild its index straight from the record table, without parsing or
+// hashing anything. Fields are written in native byte order: a snapshot is
+// meant to warm up a restart on the same kind of machine, not to be portable.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+};
+
+struct SnapshotRecord {
+    uint64_t hash;
+    // Of the key bytes, relative to the end of the record table; the value
+    // bytes follow the key.
+    uint64_t offset;
+    uint32_t key_size;
+    uint32_t value_size;
+    // Time to live left when the snapshot was taken; zero if none.
+    uint64_t ttl_ms;
+};
+
+inline constexpr char kSnapshotMagic[8] = {'L', 'R', 'U', 'S', 'N', 'A', 'P', '\0'};
+inline constexpr uint32_t kSnapshotVersion = 1;
+
+// Keys and values a snapshot can hold: std::string as its bytes, trivially
+// copyable types as their object representation.
+template <typename T>
+concept SnapshotField = std::same_as<T, std::string> ||
+                        (std::is_trivially_copyable_v<T> && std::default_initializable<T>);
+
+template <SnapshotField T>
+std::string_view snapshot_bytes(const T &field) {
+    if constexpr (std::same_as<T, std::string>) {
+        return field;
+    } else {
+        return {reinterpret_cast<const char *>(&field), sizeof(T)};
+    }
+}
+
+template <SnapshotField T>
+bool snapshot_fits(std::string_view bytes) {
+    return std::same_as<T, std::string> || bytes.size() == sizeof(T);
+}
+
+// What an entry field is built from: a view of the bytes for strings, a copy
+// of the object otherwise. The bytes must satisfy snapshot_fits<T>.
+template <SnapshotField T>
+auto snapshot_field(std::string_view bytes) {
+    if constexpr (std::same_as<T, std::string>) {
+        return bytes;
+    } else {
+        T field;
+        std::memcpy(&field, bytes.data(), sizeof(T));
+        return field;
+    }
+}
+
+// Read-only mapping of a whole file; empty if it cannot be opened or mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            const auto size = static_cast<size_t>(st.st_size);
+            void *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                // Loaders walk the file front to back once; start reading ahead.
+                ::madvise(data, size, MADV_SEQUENTIAL);
+                ::madvise(data, size, MADV_WILLNEED);
+                data_ = static_cast<const char *>(data);
+                size_ = size;
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile &operator=(MappedFile &&) = delete;
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<char *>(data_), size_);
+        }
+    }
+
+    [[nodiscard]] std::string_view bytes() const { return {data_, size_}; }
+
+private:
+    const char *data_{nullptr};
+    size_t size_{0};
+};
+#endif
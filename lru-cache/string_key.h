@@ -0,0 +1,41 @@
+#ifndef STRING_KEY_H
+
+#define STRING_KEY_H
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+// Transparent hash and equality for std::string keys: std::string, string
+// literals and std::string_view all hash and compare as std::string_view, so an
+// index can be probed without materializing a std::string. Node-based indexes
+// can also pass their entries directly, as long as they carry their own `key`.
+struct StringKeyHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+
+    template <typename Entry>
+        requires requires(const Entry &entry) { entry.key; }
+    size_t operator()(const Entry &entry) const {
+        return (*this)(std::string_view(entry.key));
+    }
+};
+
+struct StringKeyEqual {
+    using is_transparent = void;
+
+    template <typename A, typename B>
+    bool operator()(const A &a, const B &b) const {
+        return key_of(a) == key_of(b);
+    }
+
+private:
+    static std::string_view key_of(std::string_view key) { return key; }
+
+    template <typename Entry>
+        requires requires(const Entry &entry) { entry.key; }
+    static std::string_view key_of(const Entry &entry) {
+        return entry.key;
+    }
+};
+#endif
@@ -1,13 +1,77 @@
+#include "arc_cache.h"
+#include "clock_cache.h"
+#include "concurrent_lru_cache.h"
+#include "epoch.h"
+#include "flat_index.h"
+#include "frequency_sketch.h"
 #include "lru_cache.h"
+#include "sharded_lru_cache.h"
+#include "slab_allocator.h"
+#include "slab_lru_cache.h"
+#include "tiny_lfu_cache.h"
+#include "timing_wheel.h"
 #include <algorithm>
+#include <atomic>
 #include <catch2/catch_test_macros.hpp>
+#include <cctype>
+#include <chrono>
 #include <concepts>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <random>
 #include <ranges>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
+namespace {
+std::atomic<size_t> g_allocations{0};
+}  // namespace
+
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// The array forms are replaced too, so that every new and delete of the
+// program goes through the same malloc()/free() pair. GCC cannot tell that the
+// replaced operator new is malloc() underneath and, once a delete is inlined,
+// warns about free() on its result; the pair matches, so that is silenced.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+#pragma GCC diagnostic pop
+
 class RandomGenerator {
 public:
     explicit RandomGenerator(int32_t seed) : gen_(seed) {}
@@ -80,6 +144,1207 @@ TEST_CASE("Eviction") {
     REQUIRE(cache.get("f", &value));
 }
 
+TEST_CASE("Hit does not allocate") {
+    LruCache cache(3);
+    const std::string long_value(100, 'x');
+    cache.set("a", long_value);
+    cache.set("b", "2");
+    cache.set("c", "3");
+
+    const std::string key_a = "a";
+    const std::string key_b = "b";
+    std::string value;
+    value.reserve(long_value.size());
+
+    // Assertions may allocate themselves, so results are checked afterwards.
+    const auto before = g_allocations.load();
+    const bool hit_a = cache.get(key_a, &value);
+    const bool hit_b = cache.get(key_b, &value);
+    const bool hit_a_again = cache.get(key_a, &value);
+    const auto after = g_allocations.load();
+
+    REQUIRE(hit_a);
+    REQUIRE(hit_b);
+    REQUIRE(hit_a_again);
+    REQUIRE(after == before);
+    REQUIRE(value == long_value);
+
+    // Promotion on hit changed the order: "c" is now the least recently used.
+    cache.set("d", "4");
+    REQUIRE_FALSE(cache.get("c", &value));
+}
+
+TEST_CASE("Heterogeneous lookup") {
+    // Keys longer than the SSO buffer, as if parsed out of a request buffer.
+    const std::string buffer = "GET some/rather/long/cache/key/number/one HTTP/1.1";
+    const std::string_view key = std::string_view(buffer).substr(4, 37);
+
+    LruCache cache(2);
+    cache.set(key, "value");
+    std::string value;
+    value.reserve(16);
+
+    const auto before = g_allocations.load();
+    const bool hit_view = cache.get(key, &value);
+    const bool hit_string_view = cache.get(StringView(buffer.data() + 4, key.size()), &value);
+    const bool miss = cache.get(std::string_view(buffer).substr(4, 36), &value);
+    cache.set(key, "other");
+    const auto after = g_allocations.load();
+
+    REQUIRE(hit_view);
+    REQUIRE(hit_string_view);
+    REQUIRE_FALSE(miss);
+    REQUIRE(after == before);
+    REQUIRE(cache.get(std::string(key), &value));
+    REQUIRE(value == "other");
+
+    ShardedLruCache sharded(4, 2);
+    sharded.set(StringView("a"), StringView("1"));
+    REQUIRE(sharded.get(std::string_view("a"), &value));
+    REQUIRE(value == "1");
+}
+
+TEST_CASE("Zero-copy get") {
+    LruCache cache(2);
+    const std::string big(4096, 'x');
+    cache.set("a", big);
+    cache.set("b", "2");
+
+    std::string_view view;
+    const auto before = g_allocations.load();
+    const bool hit = cache.get("a", &view);
+    const auto after = g_allocations.load();
+    REQUIRE(hit);
+    REQUIRE(after == before);
+    REQUIRE(view == big);
+
+    std::string_view other;
+    REQUIRE(cache.get("b", &other));
+    REQUIRE(other == "2");
+    REQUIRE(cache.get(StringView("a"), &view));
+    REQUIRE(view == big);
+    REQUIRE_FALSE(cache.get("c", &view));
+
+    ShardedLruCache sharded(4, 2);
+    sharded.set("a", big);
+    size_t seen = 0;
+    REQUIRE(sharded.visit("a", [&seen](std::string_view v) { seen = v.size(); }));
+    REQUIRE(seen == big.size());
+    REQUIRE_FALSE(sharded.visit("b", [](std::string_view) { FAIL("must not be called"); }));
+}
+
+TEST_CASE("Byte budget") {
+    LruCache cache(10, LruCache::byte_size);
+    std::string value;
+
+    cache.set("a", "1234");
+    cache.set("b", "1234");
+    REQUIRE(cache.weight() == 10);
+    REQUIRE(cache.size() == 2);
+
+    // Needs the room of both older entries.
+    cache.set("c", "12345678");
+    REQUIRE(cache.weight() == 9);
+    REQUIRE_FALSE(cache.get("a", &value));
+    REQUIRE_FALSE(cache.get("b", &value));
+    REQUIRE(cache.get("c", &value));
+
+    cache.set("d", "");
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.weight() == 10);
+
+    // Growing an entry in place evicts from the LRU end, not the entry itself.
+    cache.set("d", "12");
+    REQUIRE(cache.weight() == 3);
+    REQUIRE_FALSE(cache.get("c", &value));
+    REQUIRE(cache.get("d", &value));
+    REQUIRE(value == "12");
+
+    // An entry larger than the whole budget is not stored and drops the old value.
+    cache.set("d", "123456789012");
+    REQUIRE_FALSE(cache.get("d", &value));
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.weight() == 0);
+}
+
+TEST_CASE("Slab allocator") {
+    SlabAllocator slabs;
+    REQUIRE(slabs.chunk_size(1) == 64);
+    REQUIRE(slabs.chunk_size(65) == 80);
+    REQUIRE(slabs.chunk_size(1 << 20) == 1 << 20);
+
+    std::vector<std::pair<void *, size_t>> chunks;
+    for (size_t i = 0; i < 20'000; ++i) {
+        const size_t size = 1 + i * 7919 % 5000;
+        auto *chunk = static_cast<char *>(slabs.allocate(size));
+        REQUIRE(reinterpret_cast<uintptr_t>(chunk) % 16 == 0);
+        std::memset(chunk, static_cast<int>(i), size);
+        chunks.emplace_back(chunk, size);
+    }
+    auto *large = slabs.allocate(3 << 20);
+    REQUIRE(slabs.mapped_bytes() >= (3 << 20) + 20'000 * 2500);
+
+    // Freed chunks are reused before new slabs are mapped.
+    const size_t mapped = slabs.mapped_bytes();
+    for (size_t i = 0; i < chunks.size(); i += 2) {
+        slabs.deallocate(chunks[i].first, chunks[i].second);
+        chunks[i].first = slabs.allocate(chunks[i].second);
+    }
+    REQUIRE(slabs.mapped_bytes() == mapped);
+
+    slabs.deallocate(large, 3 << 20);
+    for (auto [chunk, size] : chunks) {
+        slabs.deallocate(chunk, size);
+    }
+    // Only the spare slab is left.
+    REQUIRE(slabs.mapped_bytes() == SlabAllocator::kSlabSize);
+}
+
+TEST_CASE("Slab cache") {
+    // Every entry below takes a 64-byte chunk.
+    SlabLruCache cache(3 * 64);
+    std::string value;
+    std::string_view view;
+    cache.set("a", "1");
+    cache.set("b", "2");
+    cache.set("c", "3");
+    REQUIRE(cache.weight() == 3 * 64);
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "1");
+
+    cache.set("d", "4");
+    REQUIRE(cache.size() == 3);
+    REQUIRE_FALSE(cache.get("b", &value));
+    REQUIRE(cache.get("a", &view));
+    REQUIRE(view == "1");
+
+    // Same chunk size: overwritten in place. A larger one evicts from the LRU end.
+    cache.set("a", "12");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "12");
+    cache.set("d", std::string(40, 'x'));
+    REQUIRE(cache.weight() == 64 + 80);
+    REQUIRE_FALSE(cache.get("c", &value));
+    REQUIRE(cache.get("d", &value));
+    REQUIRE(value == std::string(40, 'x'));
+
+    // The new value may be a view of the stored one.
+    cache.set("a", "0123456789");
+    REQUIRE(cache.get("a", &view));
+    cache.set("a", view.substr(2, 8));
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "23456789");
+    cache.set("d", std::string(40, 'y') + "z");
+    REQUIRE(cache.get("d", &view));
+    // A shorter value moves to a smaller chunk; the old one is freed after the copy.
+    cache.set("d", view.substr(39));
+    REQUIRE(cache.get("d", &value));
+    REQUIRE(value == "yz");
+
+    // An entry larger than the whole budget is not stored and drops the old value.
+    cache.set("a", std::string(200, 'x'));
+    REQUIRE_FALSE(cache.get("a", &value));
+    REQUIRE(cache.size() == 1);
+}
+
+TEST_CASE("Slab cache churn") {
+    constexpr size_t kBudget = 16 << 20;
+
+    SlabLruCache cache(kBudget);
+    RandomGenerator rnd{7};
+    std::string value;
+    for (auto i : std::views::iota(0, 200'000)) {
+        auto key = std::to_string(rnd.genInt<uint32_t>() % 50'000);
+        // Phases of small and large values, which fragment a malloc heap.
+        const size_t size = (i / 20'000) % 2 == 0 ? 16 + rnd.genInt<uint32_t>() % 512
+                                                  : 1024 + rnd.genInt<uint32_t>() % 16384;
+        cache.set(key, std::string(size, key.back()));
+        REQUIRE(cache.weight() <= kBudget);
+        if (cache.get(key, &value) && value != std::string(size, key.back())) {
+            FAIL(key << " has a wrong value");
+        }
+    }
+
+    // Once no large value is left, their slabs are unmapped.
+    for (auto i : std::views::iota(0, 50'000)) {
+        cache.set(std::to_string(i), std::string(100, 'x'));
+    }
+    REQUIRE(cache.size() == 50'000);
+    REQUIRE(cache.mapped_bytes() <= cache.weight() + 4 * SlabAllocator::kSlabSize);
+}
+
+TEST_CASE("Custom weigher") {
+    LruCache cache(100, [](std::string_view, std::string_view value) { return value.size() * 10; });
+    std::string value;
+
+    for (auto i : std::views::iota(0, 20)) {
+        cache.set(std::to_string(i), "x");
+    }
+    REQUIRE(cache.size() == 10);
+    REQUIRE(cache.weight() == 100);
+    REQUIRE_FALSE(cache.get("9", &value));
+    REQUIRE(cache.get("10", &value));
+
+    ShardedLruCache sharded(1000, LruCache::byte_size, 4);
+    for (auto i : std::views::iota(0, 1000)) {
+        sharded.set(std::to_string(i), std::string(10, 'x'));
+    }
+    auto found = 0;
+    for (auto i : std::views::iota(0, 1000)) {
+        found += sharded.get(std::to_string(i), &value) ? 1 : 0;
+    }
+    REQUIRE(found > 0);
+    REQUIRE(found * 11 <= 1000);
+}
+
+TEST_CASE("Integer keys and struct values") {
+    struct Point {
+        int x;
+        int y;
+    };
+
+    BasicLruCache<uint64_t, Point> cache(2);
+    Point value{};
+
+    cache.set(uint64_t{1}, Point{1, 2});
+    cache.set(uint64_t{2}, Point{3, 4});
+    REQUIRE(cache.get(uint64_t{1}, &value));
+    REQUIRE(value.x == 1);
+    REQUIRE(value.y == 2);
+
+    cache.set(uint64_t{3}, Point{5, 6});
+    REQUIRE_FALSE(cache.get(uint64_t{2}, &value));
+    REQUIRE(cache.get(uint64_t{3}, &value));
+    REQUIRE(value.x == 5);
+
+    BasicLruCache<int, std::vector<int>> weighted(
+        10, [](const int &, const std::vector<int> &v) { return v.size(); });
+    weighted.set(1, std::vector<int>(6));
+    weighted.set(2, std::vector<int>(6));
+    std::vector<int> vector_value;
+    REQUIRE_FALSE(weighted.get(1, &vector_value));
+    REQUIRE(weighted.get(2, &vector_value));
+    REQUIRE(vector_value.size() == 6);
+
+    BasicShardedLruCache<uint64_t, Point> sharded(64, 4);
+    sharded.set(uint64_t{7}, Point{7, 7});
+    REQUIRE(sharded.get(uint64_t{7}, &value));
+    REQUIRE(value.y == 7);
+}
+
+TEST_CASE("Custom hash and equality") {
+    struct CaseInsensitiveHash {
+        size_t operator()(const std::string &key) const {
+            size_t hash = 0;
+            for (auto c : key) {
+                hash = hash * 31 + static_cast<size_t>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            return hash;
+        }
+    };
+    struct CaseInsensitiveEqual {
+        bool operator()(const std::string &a, const std::string &b) const {
+            return std::ranges::equal(a, b, [](char x, char y) {
+                return std::tolower(static_cast<unsigned char>(x)) ==
+                       std::tolower(static_cast<unsigned char>(y));
+            });
+        }
+    };
+
+    BasicLruCache<std::string, int, CaseInsensitiveHash, CaseInsensitiveEqual> cache(4);
+    int value = 0;
+    cache.set(std::string("Key"), 1);
+    REQUIRE(cache.get(std::string("KEY"), &value));
+    REQUIRE(value == 1);
+    cache.set(std::string("kEy"), 2);
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.get(std::string("key"), &value));
+    REQUIRE(value == 2);
+}
+
+TEST_CASE("Flat index") {
+    struct Node {
+        size_t hash;
+        uint32_t key;
+    };
+
+    // Few distinct hashes force long probe chains and shared tags.
+    constexpr auto kHash = [](uint32_t key) { return size_t{key % 97}; };
+    constexpr uint32_t kKeys = 2000;
+
+    std::vector<Node> nodes(kKeys);
+    for (uint32_t key = 0; key < kKeys; ++key) {
+        nodes[key] = {kHash(key), key};
+    }
+    auto find = [&](const FlatIndex<Node> &index, uint32_t key) {
+        return index.find(kHash(key), [key](const Node &node) { return node.key == key; });
+    };
+
+    FlatIndex<Node> index;
+    std::unordered_set<uint32_t> expected;
+    RandomGenerator rnd{12'345};
+    for (auto i = 0; i < 50'000; ++i) {
+        const auto key = rnd.genInt<uint32_t>() % kKeys;
+        if (expected.contains(key)) {
+            REQUIRE(find(index, key) == &nodes[key]);
+            index.erase(&nodes[key]);
+            expected.erase(key);
+        } else {
+            REQUIRE(find(index, key) == nullptr);
+            index.insert(&nodes[key]);
+            expected.insert(key);
+        }
+        REQUIRE(index.size() == expected.size());
+    }
+    for (uint32_t key = 0; key < kKeys; ++key) {
+        REQUIRE((find(index, key) != nullptr) == expected.contains(key));
+    }
+
+    FlatIndex<Node> reserved;
+    reserved.reserve(1000);
+    const auto capacity = reserved.capacity();
+    for (uint32_t key = 0; key < 1000; ++key) {
+        reserved.insert(&nodes[key]);
+    }
+    REQUIRE(reserved.capacity() == capacity);
+}
+
+TEST_CASE("Clock set and get") {
+    STATIC_CHECK_FALSE(std::copy_constructible<ClockCache>);
+    STATIC_CHECK_FALSE(std::move_constructible<ClockCache>);
+
+    ClockCache cache(3);
+    std::string value;
+    cache.set("a", "1");
+    cache.set("b", "2");
+    cache.set("c", "3");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "1");
+    REQUIRE_FALSE(cache.get("d", &value));
+
+    // "a" was read and gets a second chance; "b" is the first unreferenced one.
+    cache.set("d", "4");
+    REQUIRE(cache.size() == 3);
+    REQUIRE_FALSE(cache.get("b", &value));
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(cache.get("c", &value));
+    REQUIRE(cache.get("d", &value));
+
+    // Everything is referenced: the hand clears all bits on one lap and then
+    // evicts "c", where it started.
+    cache.set("e", "5");
+    REQUIRE_FALSE(cache.get("c", &value));
+    cache.set("d", "6");
+    REQUIRE(cache.get("d", &value));
+    REQUIRE(value == "6");
+
+    BasicClockCache<int, int> empty(0);
+    empty.set(1, 1);
+    REQUIRE(empty.size() == 0);
+}
+
+TEST_CASE("Clock stress") {
+    constexpr auto kSize = 1000;
+    constexpr auto kEnd = 100 * kSize;
+
+    ClockCache cache(kSize);
+    std::string value;
+    for (auto i : std::views::iota(0, kSize)) {
+        auto key = std::to_string(i);
+        cache.set(key, key);
+        REQUIRE(cache.get(key, &value));
+        REQUIRE(value == key);
+    }
+
+    // With no reads in between, CLOCK evicts in insertion order like LRU.
+    for (auto i : std::views::iota(kSize, kEnd)) {
+        cache.set(std::to_string(i), "foo");
+        if (cache.get(std::to_string(i - kSize), &value)) {
+            FAIL(i - kSize << " was not deleted");
+        }
+    }
+    REQUIRE(cache.size() == kSize);
+}
+
+TEST_CASE("Timing wheel") {
+    struct Timer {
+        uint64_t expires_at{0};
+        mutable const Timer *timer_next{nullptr};
+        mutable const Timer **timer_pprev{nullptr};
+        mutable uint64_t fired_at{0};
+    };
+
+    constexpr auto kTimers = 5000;
+    constexpr uint64_t kStart = 1'000'000;
+
+    std::vector<Timer> timers(kTimers);
+    TimingWheel<Timer> wheel(kStart);
+    RandomGenerator rnd{777};
+    for (auto i : std::views::iota(0, kTimers)) {
+        // Deadlines from the past up to far beyond the lowest levels.
+        const auto spread = uint64_t{1} << (rnd.genInt<uint32_t>() % 24);
+        timers[i].expires_at = kStart - 10 + rnd.genInt<uint32_t>() % spread;
+        wheel.schedule(&timers[i]);
+    }
+    for (auto i : std::views::iota(0, kTimers / 10)) {
+        wheel.cancel(&timers[i]);
+    }
+    REQUIRE(wheel.size() == kTimers - kTimers / 10);
+
+    auto on_expired = [&wheel](const Timer *timer) { timer->fired_at = wheel.now(); };
+    // A small budget only moves part of the way.
+    REQUIRE_FALSE(wheel.advance(kStart + 1000, 10, on_expired));
+    REQUIRE(wheel.now() < kStart + 1000);
+    for (uint64_t now = kStart; now < kStart + (1U << 24); now += 997) {
+        REQUIRE(wheel.advance(now, SIZE_MAX, on_expired));
+    }
+    REQUIRE(wheel.advance(kStart + (1U << 24), SIZE_MAX, on_expired));
+    REQUIRE(wheel.size() == 0);
+
+    for (auto i : std::views::iota(0, kTimers)) {
+        const auto &timer = timers[i];
+        if (i < kTimers / 10) {
+            REQUIRE(timer.fired_at == 0);
+        } else {
+            REQUIRE(timer.fired_at >= timer.expires_at);
+            REQUIRE(timer.fired_at <= std::max(timer.expires_at, kStart + 1));
+        }
+    }
+
+    // Empty ticks cost nothing: a sparse wheel crosses a year of milliseconds
+    // on a budget of one unit per timer and level it cascades through.
+    std::vector<Timer> sparse(4);
+    for (size_t i = 0; i < sparse.size(); ++i) {
+        sparse[i].expires_at = wheel.now() + (uint64_t{1} << (7 + 9 * i)) + i;
+        wheel.schedule(&sparse[i]);
+    }
+    const uint64_t last = sparse.back().expires_at;
+    REQUIRE(wheel.advance(last, 6 * sparse.size(), on_expired));
+    REQUIRE(wheel.now() == last);
+    REQUIRE(wheel.size() == 0);
+    for (const auto &timer : sparse) {
+        REQUIRE(timer.fired_at == timer.expires_at);
+    }
+    REQUIRE(wheel.advance(last + (uint64_t{1} << 40), 0, on_expired));
+}
+
+TEST_CASE("TTL expiration") {
+    using std::chrono_literals::operator""ms;
+
+    uint64_t now = 1000;
+    LruCache cache(100);
+    cache.set_clock([&now] { return now; });
+    std::string value;
+
+    cache.set("forever", "1");
+    cache.set("short", "2", 10ms);
+    cache.set_default_ttl(100ms);
+    cache.set("default", "3");
+
+    now += 9;
+    REQUIRE(cache.get("short", &value));
+    now += 1;
+    REQUIRE_FALSE(cache.get("short", &value));
+    REQUIRE(cache.size() == 2);
+
+    // Overwriting restarts the TTL.
+    now += 50;
+    cache.set("default", "4");
+    now += 60;
+    REQUIRE(cache.get("default", &value));
+    REQUIRE(value == "4");
+    now += 40;
+    REQUIRE_FALSE(cache.get("default", &value));
+    REQUIRE(cache.get("forever", &value));
+
+    // Entries nobody reads are reclaimed by the timing wheel.
+    for (auto i : std::views::iota(0, 50)) {
+        cache.set(std::to_string(i), "x", std::chrono::milliseconds(1 + i % 5));
+    }
+    REQUIRE(cache.size() == 51);
+    now += 5;
+    REQUIRE(cache.expire());
+    REQUIRE(cache.size() == 1);
+
+    // Long TTLs pass through the higher levels of the wheel.
+    cache.set("long", "5", std::chrono::milliseconds(1'000'000));
+    now += 999'999;
+    REQUIRE(cache.expire());
+    REQUIRE(cache.get("long", &value));
+    now += 1;
+    REQUIRE(cache.expire());
+    REQUIRE(cache.size() == 1);
+
+    // A cache that is rarely written still reclaims expired entries after a
+    // long pause: the wheel skips the empty ticks in between.
+    for (auto i : std::views::iota(0, 10)) {
+        cache.set("idle" + std::to_string(i), "x", std::chrono::milliseconds(10));
+    }
+    now += 1'000'000'000;
+    cache.set("after", "y");
+    REQUIRE(cache.size() == 2);
+
+    ShardedLruCache sharded(100, 4);
+    sharded.set_clock([&now] { return now; });
+    sharded.set("a", "1", 5ms);
+    sharded.set("b", "2");
+    now += 5;
+    REQUIRE(sharded.expire());
+    REQUIRE_FALSE(sharded.get("a", &value));
+    REQUIRE(sharded.get("b", &value));
+}
+
+TEST_CASE("Batch get and set") {
+    constexpr size_t kCount = 100;
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    for (auto i : std::views::iota(size_t{0}, kCount)) {
+        keys.push_back("key" + std::to_string(i));
+        values.push_back("value" + std::to_string(i));
+    }
+
+    LruCache cache(kCount);
+    cache.set_many(keys, values);
+    REQUIRE(cache.size() == kCount);
+
+    // Every other key, plus some that are missing.
+    std::vector<std::string_view> probes;
+    for (size_t i = 0; i < kCount + 20; i += 2) {
+        probes.push_back(i < kCount ? std::string_view(keys[i]) : std::string_view("missing"));
+    }
+    std::vector<std::string> found_values(probes.size());
+    auto found = std::make_unique<bool[]>(probes.size());
+    REQUIRE(cache.get_many(probes, found_values.data(), found.get()) == kCount / 2);
+    for (size_t i = 0; i < probes.size(); ++i) {
+        REQUIRE(found[i] == (i * 2 < kCount));
+        if (found[i]) {
+            REQUIRE(found_values[i] == values[i * 2]);
+        }
+    }
+
+    // The batch promoted the probed keys: a full set of new keys evicts the
+    // keys that were not probed first.
+    std::vector<std::string> fresh;
+    for (auto i : std::views::iota(size_t{0}, kCount / 2)) {
+        fresh.push_back("fresh" + std::to_string(i));
+    }
+    cache.set_many(fresh, fresh);
+    std::string value;
+    REQUIRE(cache.get(keys[0], &value));
+    REQUIRE_FALSE(cache.get(keys[1], &value));
+
+    std::vector<std::string_view> views(2);
+    const std::vector<std::string_view> pair = {keys[0], fresh[0]};
+    REQUIRE(cache.get_many(pair, views.data(), found.get()) == 2);
+    REQUIRE(views[0] == values[0]);
+    REQUIRE(views[1] == fresh[0]);
+
+    ShardedLruCache sharded(kCount * 2, 4);
+    sharded.set_many(keys, values);
+    REQUIRE(sharded.get_many(probes, found_values.data(), found.get()) == kCount / 2);
+    for (size_t i = 0; i < probes.size(); ++i) {
+        REQUIRE(found[i] == (i * 2 < kCount));
+        if (found[i]) {
+            REQUIRE(found_values[i] == values[i * 2]);
+        }
+    }
+}
+
+TEST_CASE("Snapshot") {
+    using std::chrono_literals::operator""ms;
+
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "lru_cache_test.snapshot").string();
+    uint64_t now = 1000;
+    std::string value;
+    {
+        LruCache cache(10);
+        cache.set_clock([&now] { return now; });
+        cache.set("a", "1");
+        cache.set("b", std::string(1000, 'b'));
+        cache.set("c", "3", 100ms);
+        cache.set("gone", "4", 10ms);
+        cache.get("a", &value);
+        now += 40;
+        REQUIRE(cache.save(path));
+    }
+
+    uint64_t later = 5000;
+    LruCache restored(3);
+    restored.set_clock([&later] { return later; });
+    REQUIRE(restored.load(path));
+    REQUIRE(restored.size() == 3);
+    REQUIRE_FALSE(restored.load(path));
+    REQUIRE(restored.get("b", &value));
+    REQUIRE(value == std::string(1000, 'b'));
+
+    // Recency survives: "c" is now the least recently used entry.
+    restored.set("d", "5");
+    REQUIRE_FALSE(restored.get("c", &value));
+    REQUIRE(restored.get("a", &value));
+    REQUIRE(value == "1");
+
+    // The remaining TTL does too: "c" had 60ms left.
+    LruCache with_ttl(10);
+    with_ttl.set_clock([&later] { return later; });
+    REQUIRE(with_ttl.load(path));
+    later += 59;
+    REQUIRE(with_ttl.get("c", &value));
+    later += 1;
+    REQUIRE_FALSE(with_ttl.get("c", &value));
+
+    // Only the most recent entries of a larger snapshot are kept.
+    LruCache small(1);
+    REQUIRE(small.load(path));
+    REQUIRE(small.size() == 1);
+    REQUIRE(small.get("a", &value));
+
+    BasicLruCache<uint64_t, uint64_t> numbers(100);
+    for (auto i : std::views::iota(uint64_t{0}, uint64_t{100})) {
+        numbers.set(i, i * i);
+    }
+    REQUIRE(numbers.save(path));
+    BasicLruCache<uint64_t, uint64_t> numbers_restored(100);
+    REQUIRE(numbers_restored.load(path));
+    uint64_t square = 0;
+    REQUIRE(numbers_restored.get(uint64_t{7}, &square));
+    REQUIRE(square == 49);
+
+    // Strings take any bytes, but fixed-size fields must match in size.
+    LruCache strings(100);
+    REQUIRE(strings.load(path));
+    BasicLruCache<uint32_t, uint64_t> narrow(100);
+    REQUIRE_FALSE(narrow.load(path));
+    REQUIRE(narrow.size() == 0);
+
+    // A key stored twice is rejected.
+    {
+        LruCache pair(10);
+        pair.set("k1", "x");
+        pair.set("k2", "y");
+        REQUIRE(pair.save(path));
+        std::string bytes;
+        {
+            std::ifstream in(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        // Rename "k2" to "k1", stored hash included.
+        bytes.replace(bytes.rfind("k2"), 2, "k1");
+        SnapshotRecord records[2];
+        std::memcpy(records, bytes.data() + sizeof(SnapshotHeader), sizeof(records));
+        records[1].hash = records[0].hash;
+        bytes.replace(sizeof(SnapshotHeader), sizeof(records), reinterpret_cast<const char *>(records),
+                      sizeof(records));
+        std::ofstream(path, std::ios::binary | std::ios::trunc)
+            .write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        LruCache duplicated(10);
+        REQUIRE_FALSE(duplicated.load(path));
+        REQUIRE(duplicated.size() == 0);
+    }
+
+    // TTLs are scheduled on a wheel moved to the current time, so expired
+    // entries are reclaimed by set() however far the clock is from zero.
+    {
+        uint64_t epoch = 5'000'000'000;
+        LruCache source(100);
+        source.set_clock([&epoch] { return epoch; });
+        for (auto i : std::views::iota(0, 10)) {
+            source.set("ttl" + std::to_string(i), "x", 10ms);
+        }
+        source.set("kept", "y");
+        REQUIRE(source.save(path));
+        LruCache warm(100);
+        warm.set_clock([&epoch] { return epoch; });
+        REQUIRE(warm.load(path));
+        REQUIRE(warm.size() == 11);
+        epoch += 10;
+        warm.set("new", "z");
+        REQUIRE(warm.size() == 2);
+        REQUIRE(warm.expire());
+    }
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    LruCache truncated(100);
+    REQUIRE_FALSE(truncated.load(path));
+    REQUIRE(truncated.size() == 0);
+
+    // Entries a failed load evicted are dropped, not handed to the listener.
+    {
+        LruCache source(100);
+        for (auto i : std::views::iota(0, 10)) {
+            source.set("key" + std::to_string(i), "value");
+        }
+        REQUIRE(source.save(path));
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 5);
+        LruCache listened(60, LruCache::byte_size);
+        std::vector<std::string> evicted;
+        listened.set_eviction_listener(
+            [&evicted](std::string &&key, std::string &&) { evicted.push_back(key); });
+        REQUIRE_FALSE(listened.load(path));
+        REQUIRE(listened.size() == 0);
+        listened.set("x", "y");
+        REQUIRE(evicted.empty());
+    }
+    std::filesystem::remove(path);
+    REQUIRE_FALSE(truncated.load(path));
+}
+
+template <typename Cache>
+concept HasStats = requires(const Cache &cache) { cache.stats(); };
+
+TEST_CASE("Stats") {
+    using std::chrono_literals::operator""ms;
+    using StatsCache =
+        BasicLruCache<std::string, std::string, StringKeyHash, StringKeyEqual, CacheStats>;
+
+    // Without the policy there is nothing to count or export.
+    STATIC_CHECK_FALSE(HasStats<LruCache>);
+    STATIC_CHECK(HasStats<StatsCache>);
+    STATIC_CHECK(sizeof(StatsCache) > sizeof(LruCache));
+
+    uint64_t now = 0;
+    StatsCache cache(3);
+    cache.set_clock([&now] { return now; });
+    std::string value;
+
+    cache.set("a", "11");
+    cache.set("b", "22");
+    cache.set("a", "1111");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE_FALSE(cache.get("z", &value));
+    cache.set("c", "33", 10ms);
+    cache.set("d", "44");
+    now += 10;
+    REQUIRE_FALSE(cache.get("c", &value));
+
+    auto stats = cache.stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.inserts == 4);
+    REQUIRE(stats.updates == 1);
+    REQUIRE(stats.evictions == 1);
+    REQUIRE(stats.expirations == 1);
+    REQUIRE(stats.entries == cache.size());
+    REQUIRE(stats.bytes == (1 + 4) + (1 + 2));
+
+    BasicShardedLruCache<std::string, std::string, StringKeyHash, StringKeyEqual, CacheStats>
+        sharded(100, 4);
+    for (auto i : std::views::iota(0, 50)) {
+        sharded.set(std::to_string(i), "x");
+    }
+    for (auto i : std::views::iota(0, 100)) {
+        sharded.get(std::to_string(i), &value);
+    }
+    stats = sharded.stats();
+    REQUIRE(stats.inserts == 50);
+    REQUIRE(stats.entries == 50);
+    REQUIRE(stats.hits == 50);
+    REQUIRE(stats.misses == 50);
+}
+
+namespace {
+// Counts copies, so tests can tell moves from copies.
+struct Blob {
+    explicit Blob(int id) : id(id) {}
+    Blob(const Blob &other) : id(other.id) { ++copies; }
+    Blob(Blob &&other) noexcept = default;
+    Blob &operator=(const Blob &other) {
+        id = other.id;
+        ++copies;
+        return *this;
+    }
+    Blob &operator=(Blob &&other) noexcept = default;
+    ~Blob() = default;
+
+    int id;
+    inline static int copies = 0;
+};
+}  // namespace
+
+TEST_CASE("Eviction listener") {
+    // A two-tier cache: evicted entries spill into `disk`.
+    std::vector<std::pair<int, int>> disk;
+    BasicLruCache<int, Blob> cache(2);
+    cache.set_eviction_listener([&disk](int &&key, Blob &&blob) {
+        disk.emplace_back(key, Blob(std::move(blob)).id);
+    });
+    for (auto i : std::views::iota(0, 5)) {
+        cache.set(i, Blob(i * 10));
+    }
+    REQUIRE(Blob::copies == 0);
+    REQUIRE(disk == std::vector<std::pair<int, int>>{{0, 0}, {1, 10}, {2, 20}});
+
+    // Expired entries are not spilled.
+    uint64_t now = 0;
+    cache.set_clock([&now] { return now; });
+    cache.set(5, Blob(50), std::chrono::milliseconds(1));
+    now += 1;
+    REQUIRE(cache.expire());
+    REQUIRE(disk.size() == 4);
+
+    // The listener may use the cache: here it re-inserts what it is handed.
+    LruCache strings(2);
+    std::vector<std::string> seen;
+    strings.set_eviction_listener([&](std::string &&key, std::string &&value) {
+        seen.push_back(key);
+        if (key == "a") {
+            strings.set("a-again", std::move(value));
+        }
+    });
+    strings.set("a", "1");
+    strings.set("b", "2");
+    strings.set("c", "3");
+    std::string value;
+    REQUIRE(strings.get("a-again", &value));
+    REQUIRE(value == "1");
+    REQUIRE(seen == std::vector<std::string>{"a", "b"});
+
+    // Too large to ever fit: the new value goes straight to the listener.
+    LruCache weighted(4, LruCache::byte_size);
+    seen.clear();
+    weighted.set_eviction_listener(
+        [&seen](std::string &&key, std::string &&) { seen.push_back(key); });
+    weighted.set("huge", "value");
+    REQUIRE(weighted.size() == 0);
+    REQUIRE(seen == std::vector<std::string>{"huge"});
+
+    // With one shard, a listener that ran under the shard lock would deadlock.
+    ShardedLruCache sharded(2, 1);
+    std::vector<std::string> spilled;
+    sharded.set_eviction_listener([&](std::string &&key, std::string &&) {
+        std::string ignored;
+        sharded.get(key, &ignored);
+        spilled.push_back(std::move(key));
+    });
+    const std::vector<std::string> keys = {"a", "b", "c", "d"};
+    sharded.set_many(keys, keys);
+    sharded.set("e", "5");
+    REQUIRE(spilled == std::vector<std::string>{"a", "b", "c"});
+}
+
+TEST_CASE("Get or load") {
+    LruCache cache(10);
+    int calls = 0;
+    const auto load = [&calls](std::string_view key) {
+        ++calls;
+        return std::string(key) + "!";
+    };
+    REQUIRE(cache.get_or_load("a", load) == "a!");
+    REQUIRE(cache.get_or_load("a", load) == "a!");
+    REQUIRE(calls == 1);
+
+    // Concurrent misses on one key share a single load.
+    constexpr int kThreads = 8;
+    ShardedLruCache sharded(100, 4);
+    std::atomic<int> backend_calls{0};
+    std::atomic<int> started{0};
+    std::vector<std::string> results(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            started.fetch_add(1);
+            results[t] = sharded.get_or_load("hot", [&](std::string_view key) {
+                backend_calls.fetch_add(1);
+                // Keep the load in flight until every thread has asked.
+                while (started.load() < kThreads) {
+                    std::this_thread::yield();
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                return std::string(key) + "-value";
+            });
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(backend_calls.load() == 1);
+    for (const auto &result : results) {
+        REQUIRE(result == "hot-value");
+    }
+    std::string value;
+    REQUIRE(sharded.get("hot", &value));
+
+    // A failed load reaches the caller, is not cached and is retried.
+    REQUIRE_THROWS(sharded.get_or_load("bad", [](std::string_view) -> std::string {
+        throw std::runtime_error("backend down");
+    }));
+    REQUIRE_FALSE(sharded.get("bad", &value));
+    REQUIRE(sharded.get_or_load("bad", [](std::string_view) { return std::string("ok"); }) == "ok");
+
+    // A set() during the load wins over the older loaded value.
+    REQUIRE(sharded.get_or_load("raced", [&](std::string_view) {
+        sharded.set("raced", "fresh");
+        return std::string("stale");
+    }) == "fresh");
+    REQUIRE(sharded.get("raced", &value));
+    REQUIRE(value == "fresh");
+}
+
+TEST_CASE("Concurrent set and get") {
+    STATIC_CHECK_FALSE(std::copy_constructible<ConcurrentLruCache>);
+    STATIC_CHECK_FALSE(std::move_constructible<ConcurrentLruCache>);
+
+    ConcurrentLruCache cache(3);
+    std::string value;
+    cache.set("a", "1");
+    cache.set("b", "2");
+    cache.set("c", "3");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "1");
+    REQUIRE_FALSE(cache.get("d", &value));
+
+    // The hit on "a" is buffered and applied by the next set(), before it
+    // picks a victim.
+    cache.set("d", "4");
+    REQUIRE(cache.size() == 3);
+    REQUIRE_FALSE(cache.get("b", &value));
+    REQUIRE(cache.get("a", &value));
+
+    cache.set("c", "5");
+    REQUIRE(cache.size() == 3);
+    REQUIRE(cache.get("c", &value));
+    REQUIRE(value == "5");
+
+    BasicConcurrentLruCache<int, int> empty(0);
+    empty.set(1, 1);
+    REQUIRE(empty.size() == 0);
+}
+
+TEST_CASE("Concurrent eviction") {
+    constexpr auto kSize = 1000;
+
+    ConcurrentLruCache cache(kSize, 4);
+    std::string value;
+    for (auto i : std::views::iota(0, 100 * kSize)) {
+        cache.set(std::to_string(i), "foo");
+        if (i >= kSize && cache.get(std::to_string(i - kSize), &value)) {
+            FAIL(i - kSize << " was not deleted");
+        }
+    }
+    REQUIRE(cache.size() == kSize);
+}
+
+TEST_CASE("Epoch reclamation") {
+    struct Node {
+        explicit Node(int *deleted) : deleted(deleted) {}
+        Node(const Node &) = delete;
+        Node &operator=(const Node &) = delete;
+        ~Node() { ++*deleted; }
+
+        int *deleted;
+    };
+
+    int deleted = 0;
+    {
+        EpochReclaimer<Node> reclaimer(4);
+        {
+            const auto guard = reclaimer.pin();
+            reclaimer.retire(new Node(&deleted));
+            // The reader pinned before the retire may still see the node.
+            REQUIRE(reclaimer.collect());
+            REQUIRE_FALSE(reclaimer.collect());
+            REQUIRE(deleted == 0);
+        }
+        REQUIRE(reclaimer.collect());
+        REQUIRE(deleted == 1);
+        REQUIRE(reclaimer.pending() == 0);
+
+        reclaimer.retire(new Node(&deleted));
+    }
+    REQUIRE(deleted == 2);
+}
+
+TEST_CASE("Concurrent stress") {
+    constexpr auto kThreads = 8;
+    constexpr auto kOps = 50'000;
+
+    ConcurrentLruCache cache(200);
+    std::vector<std::thread> threads;
+    std::vector<int> errors(kThreads);
+    for (auto t : std::views::iota(0, kThreads)) {
+        threads.emplace_back([&cache, &errors, t] {
+            RandomGenerator rnd{t + 1};
+            std::string value;
+            for (auto i = 0; i < kOps; ++i) {
+                auto key = std::to_string(rnd.genInt<uint32_t>() % 1000);
+                if (rnd.genInt<uint32_t>() % 20 == 0) {
+                    cache.set(key, key);
+                } else if (cache.get(key, &value) && value != key) {
+                    ++errors[t];
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (auto e : errors) {
+        REQUIRE(e == 0);
+    }
+    REQUIRE(cache.size() <= 200);
+}
+
+TEST_CASE("Frequency sketch") {
+    FrequencySketch sketch(64);
+    constexpr uint64_t kHot = 12'345;
+    constexpr uint64_t kCold = 67'890;
+
+    for (auto i = 0; i < 10; ++i) {
+        sketch.increment(kHot);
+    }
+    sketch.increment(kCold);
+    REQUIRE(sketch.frequency(kHot) >= 10);
+    REQUIRE(sketch.frequency(kCold) >= 1);
+    REQUIRE(sketch.frequency(kCold) < sketch.frequency(kHot));
+
+    // Counters saturate and then halve once sample_size() increments were made.
+    for (auto i = 0; i < 20; ++i) {
+        sketch.increment(kHot);
+    }
+    REQUIRE(sketch.frequency(kHot) == FrequencySketch::kMaxFrequency);
+    for (uint64_t i = 0; i < sketch.sample_size(); ++i) {
+        sketch.increment(1'000'000 + i);
+    }
+    REQUIRE(sketch.frequency(kHot) < FrequencySketch::kMaxFrequency);
+}
+
+TEST_CASE("TinyLfu set and get") {
+    STATIC_CHECK_FALSE(std::copy_constructible<TinyLfuCache>);
+    STATIC_CHECK_FALSE(std::move_constructible<TinyLfuCache>);
+
+    TinyLfuCache cache(10);
+    std::string value;
+
+    cache.set("a", "1");
+    cache.set("b", "2");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "1");
+    REQUIRE(cache.get("b", &value));
+    REQUIRE(value == "2");
+    REQUIRE_FALSE(cache.get("c", &value));
+
+    cache.set("a", "3");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "3");
+
+    for (auto i : std::views::iota(0, 1000)) {
+        cache.set(std::to_string(i), "x");
+        REQUIRE(cache.size() <= 10);
+    }
+
+    TinyLfuCache single(1);
+    single.set("a", "1");
+    single.set("b", "2");
+    REQUIRE(single.size() == 1);
+}
+
+TEST_CASE("TinyLfu resists scans") {
+    constexpr auto kSize = 1000;
+    constexpr auto kHot = 500;
+
+    TinyLfuCache tiny_lfu(kSize);
+    LruCache lru(kSize);
+    std::string value;
+    for (auto round = 0; round < 5; ++round) {
+        for (auto i : std::views::iota(0, kHot)) {
+            auto key = "hot" + std::to_string(i);
+            if (!tiny_lfu.get(key, &value)) {
+                tiny_lfu.set(key, key);
+            }
+            if (!lru.get(key, &value)) {
+                lru.set(key, key);
+            }
+        }
+    }
+    for (auto i : std::views::iota(0, 20 * kSize)) {
+        auto key = "scan" + std::to_string(i);
+        if (!tiny_lfu.get(key, &value)) {
+            tiny_lfu.set(key, key);
+        }
+        if (!lru.get(key, &value)) {
+            lru.set(key, key);
+        }
+    }
+
+    auto tiny_lfu_hits = 0;
+    auto lru_hits = 0;
+    for (auto i : std::views::iota(0, kHot)) {
+        auto key = "hot" + std::to_string(i);
+        tiny_lfu_hits += tiny_lfu.get(key, &value) ? 1 : 0;
+        lru_hits += lru.get(key, &value) ? 1 : 0;
+    }
+    REQUIRE(lru_hits == 0);
+    REQUIRE(tiny_lfu_hits > kHot * 9 / 10);
+}
+
+TEST_CASE("Arc set and get") {
+    STATIC_CHECK_FALSE(std::copy_constructible<ArcCache>);
+    STATIC_CHECK_FALSE(std::move_constructible<ArcCache>);
+
+    ArcCache cache(4);
+    std::string value;
+    for (const auto *key : {"a", "b", "c", "d"}) {
+        cache.set(key, key);
+    }
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "a");
+    REQUIRE_FALSE(cache.get("x", &value));
+
+    // "a" was seen twice and sits in T2; "b" is the LRU entry of T1.
+    cache.set("e", "e");
+    REQUIRE(cache.size() == 4);
+    REQUIRE_FALSE(cache.get("b", &value));
+    REQUIRE(cache.recency_target() == 0);
+
+    // "b" is a ghost in B1: setting it again grows the recency target.
+    cache.set("b", "B");
+    REQUIRE(cache.recency_target() == 1);
+    REQUIRE(cache.size() == 4);
+    REQUIRE(cache.get("b", &value));
+    REQUIRE(value == "B");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE_FALSE(cache.get("c", &value));
+
+    for (auto i : std::views::iota(0, 1000)) {
+        cache.set(std::to_string(i % 7), std::to_string(i));
+        REQUIRE(cache.size() <= 4);
+        REQUIRE(cache.get(std::to_string(i % 7), &value));
+        REQUIRE(value == std::to_string(i));
+    }
+
+    ArcCache empty(0);
+    empty.set("a", "1");
+    REQUIRE(empty.size() == 0);
+}
+
+TEST_CASE("Arc resists scans") {
+    constexpr auto kSize = 1000;
+    constexpr auto kHot = 500;
+
+    ArcCache cache(kSize);
+    std::string value;
+    for (auto round = 0; round < 5; ++round) {
+        for (auto i : std::views::iota(0, kHot)) {
+            auto key = "hot" + std::to_string(i);
+            if (!cache.get(key, &value)) {
+                cache.set(key, key);
+            }
+        }
+    }
+    for (auto i : std::views::iota(0, 20 * kSize)) {
+        auto key = "scan" + std::to_string(i);
+        if (!cache.get(key, &value)) {
+            cache.set(key, key);
+        }
+    }
+
+    auto hits = 0;
+    for (auto i : std::views::iota(0, kHot)) {
+        hits += cache.get("hot" + std::to_string(i), &value) ? 1 : 0;
+    }
+    REQUIRE(hits == kHot);
+}
+
 TEST_CASE("Stress 1") {
     constexpr auto kSize = 1000;
     constexpr auto kEnd = 100 * kSize;
@@ -158,3 +1423,93 @@ TEST_CASE("Stress 3") {
         }
     }
 }
+
+TEST_CASE("Sharded set and get") {
+    STATIC_CHECK_FALSE(std::copy_constructible<ShardedLruCache>);
+    STATIC_CHECK_FALSE(std::move_constructible<ShardedLruCache>);
+
+    ShardedLruCache cache(64, 4);
+    REQUIRE(cache.shard_count() == 4);
+    std::string value;
+
+    cache.set("a", "1");
+    cache.set("b", "2");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "1");
+    REQUIRE(cache.get("b", &value));
+    REQUIRE(value == "2");
+    REQUIRE_FALSE(cache.get("c", &value));
+
+    cache.set("a", "3");
+    REQUIRE(cache.get("a", &value));
+    REQUIRE(value == "3");
+}
+
+TEST_CASE("Sharded eviction") {
+    constexpr auto kSize = 1000;
+
+    ShardedLruCache cache(kSize, 8);
+    for (auto i : std::views::iota(0, 10 * kSize)) {
+        cache.set(std::to_string(i), "foo");
+    }
+
+    auto found = 0;
+    std::string value;
+    for (auto i : std::views::iota(0, 10 * kSize)) {
+        found += cache.get(std::to_string(i), &value) ? 1 : 0;
+    }
+    REQUIRE(found > 0);
+    REQUIRE(found <= kSize);
+    REQUIRE(cache.get(std::to_string(10 * kSize - 1), &value));
+}
+
+TEST_CASE("Sharded budget is split exactly") {
+    std::string value;
+    for (size_t max_size : {0, 1, 3, 4, 15, 16, 17, 100}) {
+        ShardedLruCache cache(max_size, 16);
+        REQUIRE(cache.shard_count() == std::max<size_t>(std::min<size_t>(max_size, 16), 1));
+        for (auto i : std::views::iota(0, 1000)) {
+            cache.set(std::to_string(i), "foo");
+        }
+        REQUIRE(cache.size() <= max_size);
+        // Every shard has room, so the last key is always kept.
+        if (max_size != 0) {
+            REQUIRE(cache.get("999", &value));
+        }
+    }
+    // Remainders are not dropped: 100 entries over 16 shards give 100 slots.
+    ShardedLruCache cache(100, 16);
+    for (auto i : std::views::iota(0, 100'000)) {
+        cache.set(std::to_string(i), "foo");
+    }
+    REQUIRE(cache.size() == 100);
+}
+
+TEST_CASE("Sharded stress") {
+    constexpr auto kThreads = 8;
+    constexpr auto kOps = 50'000;
+
+    ShardedLruCache cache(200);
+    std::vector<std::thread> threads;
+    std::vector<int> errors(kThreads);
+    for (auto t : std::views::iota(0, kThreads)) {
+        threads.emplace_back([&cache, &errors, t] {
+            RandomGenerator rnd{t + 1};
+            std::string value;
+            for (auto i = 0; i < kOps; ++i) {
+                auto key = std::to_string(rnd.genInt<uint32_t>() % 1000);
+                if (rnd.genInt<uint32_t>() % 4 == 0) {
+                    cache.set(key, key);
+                } else if (cache.get(key, &value) && value != key) {
+                    ++errors[t];
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (auto e : errors) {
+        REQUIRE(e == 0);
+    }
+}
@@ -0,0 +1,170 @@
+#ifndef TIMING_WHEEL_H
+
+#define TIMING_WHEEL_H
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Hierarchical timing wheel of intrusive nodes, used to expire cache entries.
+// Level 0 has one slot per tick, each next level one slot per 64 ticks of the
+// level below; six levels cover 2^36 ticks (about two years of milliseconds),
+// later deadlines wait in the top level and are rescheduled as it turns.
+// schedule() and cancel() are O(1). advance() moves time forward, cascading
+// slots of higher levels down as it goes. A bitmap of occupied slots per level
+// lets it jump straight to the next tick that has work, so its cost follows
+// the nodes it visits rather than the time elapsed, and it stops after a
+// budget of work so that catching up never stalls its caller.
+//
+// Node must provide `uint64_t expires_at` and the intrusive links
+// `mutable const Node *timer_next` and `mutable const Node **timer_pprev`;
+// timer_pprev is nullptr while a node is not scheduled.
+template <typename Node>
+class TimingWheel {
+public:
+    explicit TimingWheel(uint64_t now = 0) : current_(now) {}
+
+    TimingWheel(const TimingWheel &) = delete;
+    TimingWheel(TimingWheel &&) = delete;
+    TimingWheel &operator=(const TimingWheel &) = delete;
+    TimingWheel &operator=(TimingWheel &&) = delete;
+    ~TimingWheel() = default;
+
+    // Last tick that has been processed.
+    [[nodiscard]] uint64_t now() const { return current_; }
+    [[nodiscard]] size_t size() const { return size_; }
+
+    void schedule(const Node *node) {
+        // Deadlines that already passed fire on the next tick.
+        const uint64_t when = std::max(node->expires_at, current_ + 1);
+        const uint64_t delta = when - current_;
+        size_t level = 0;
+        while (level + 1 < kLevels && delta >> (kSlotBits * (level + 1)) != 0) {
+            ++level;
+        }
+        // Deadlines beyond the top level park in its furthest slot.
+        const uint64_t slot_time =
+            level + 1 == kLevels ? std::min(when, current_ + kSpan - 1) : when;
+        link(&slots_[level][(slot_time >> (kSlotBits * level)) & kSlotMask], node);
+        ++size_;
+    }
+
+    void cancel(const Node *node) {
+        if (node->timer_pprev != nullptr) {
+            unlink(node);
+            --size_;
+        }
+    }
+
+    // Processes ticks up to `now`, calling on_expired(node) for every node
+    // whose deadline has been reached; expired nodes are unscheduled before the
+    // call, so the callback may destroy them. Ticks with nothing to do are
+    // skipped for free; each node expired or cascaded to a lower level costs
+    // one unit of `budget`, and the current tick is always finished. Returns
+    // false if the budget ran out before `now` was reached.
+    template <typename OnExpired>
+    bool advance(uint64_t now, size_t budget, OnExpired &&on_expired) {
+        while (current_ < now) {
+            const uint64_t next = size_ == 0 ? UINT64_MAX : next_busy_tick();
+            if (next > now) {
+                current_ = now;
+                break;
+            }
+            if (budget == 0) {
+                return false;
+            }
+            current_ = next;
+            for (size_t level = 1; level < kLevels; ++level) {
+                if ((current_ & ((uint64_t{1} << (kSlotBits * level)) - 1)) != 0) {
+                    break;
+                }
+                drain(level, (current_ >> (kSlotBits * level)) & kSlotMask, budget, on_expired);
+            }
+            drain(0, current_ & kSlotMask, budget, on_expired);
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t kLevels = 6;
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr size_t kSlots = size_t{1} << kSlotBits;
+    static constexpr uint64_t kSlotMask = kSlots - 1;
+    static constexpr uint64_t kSpan = uint64_t{1} << (kSlotBits * kLevels);
+
+    void link(const Node **head, const Node *node) {
+        node->timer_next = *head;
+        node->timer_pprev = head;
+        if (*head != nullptr) {
+            (*head)->timer_pprev = &node->timer_next;
+        }
+        *head = node;
+        const auto index = static_cast<size_t>(head - &slots_[0][0]);
+        occupied_[index / kSlots] |= uint64_t{1} << (index % kSlots);
+    }
+
+    void unlink(const Node *node) {
+        const Node **pprev = node->timer_pprev;
+        *pprev = node->timer_next;
+        if (node->timer_next != nullptr) {
+            node->timer_next->timer_pprev = pprev;
+        }
+        node->timer_pprev = nullptr;
+        // A node with no predecessor is linked from its slot; std::less
+        // orders pointers into different objects too.
+        const Node **first = &slots_[0][0];
+        if (*pprev == nullptr && !std::less<const Node **>()(pprev, first) &&
+            std::less<const Node **>()(pprev, first + kLevels * kSlots)) {
+            const auto index = static_cast<size_t>(pprev - first);
+            occupied_[index / kSlots] &= ~(uint64_t{1} << (index % kSlots));
+        }
+    }
+
+    // First tick after current_ with a slot to process: level 0 slots are
+    // processed at their own tick, a level L slot when the ticks reach a
+    // multiple of 64^L that maps to it. Every scheduled node sits in a slot
+    // processed within one turn of its level, so a turn's search suffices.
+    [[nodiscard]] uint64_t next_busy_tick() const {
+        uint64_t next = UINT64_MAX;
+        for (size_t level = 0; level < kLevels; ++level) {
+            if (occupied_[level] == 0) {
+                continue;
+            }
+            const unsigned shift = kSlotBits * level;
+            const uint64_t first_turn = (current_ >> shift) + 1;
+            const auto skip = static_cast<uint64_t>(
+                std::countr_zero(std::rotr(occupied_[level], static_cast<int>(first_turn & kSlotMask))));
+            next = std::min(next, (first_turn + skip) << shift);
+        }
+        return next;
+    }
+
+    // Empties a slot: due nodes expire, the others move to lower levels.
+    template <typename OnExpired>
+    void drain(size_t level, uint64_t slot, size_t &budget, OnExpired &on_expired) {
+        const Node **head = &slots_[level][slot];
+        const Node *node = *head;
+        *head = nullptr;
+        occupied_[level] &= ~(uint64_t{1} << slot);
+        while (node != nullptr) {
+            const Node *next = node->timer_next;
+            node->timer_pprev = nullptr;
+            --size_;
+            budget -= std::min<size_t>(budget, 1);
+            if (node->expires_at <= current_) {
+                on_expired(node);
+            } else {
+                schedule(node);
+            }
+            node = next;
+        }
+    }
+
+    const Node *slots_[kLevels][kSlots]{};
+    // Bit s of occupied_[level] is set while slots_[level][s] is not empty.
+    uint64_t occupied_[kLevels]{};
+    uint64_t current_;
+    size_t size_{0};
+};
+#endif
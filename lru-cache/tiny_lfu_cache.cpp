@@ -0,0 +1,95 @@
+#include "tiny_lfu_cache.h"
+
+#include <algorithm>
+
+TinyLfuCache::TinyLfuCache(size_t max_size)
+    : sketch_(max_size),
+      max_window_size_(std::max<size_t>(max_size / 100, 1)),
+      max_main_size_(max_size - std::min(max_size, max_window_size_)),
+      max_protected_size_(max_main_size_ * 8 / 10) {}
+
+void TinyLfuCache::set(std::string_view key, std::string_view value) {
+    sketch_.increment(StringKeyHash{}(key));
+    if (auto it = data_.find(key); it != data_.end()) {
+        it->value = value;
+        on_hit(&*it);
+        return;
+    }
+    if (max_window_size_ + max_main_size_ == 0) {
+        return;
+    }
+    window_.push_back(&*data_.emplace(key, value).first);
+    if (window_.size() > max_window_size_) {
+        evict();
+    }
+}
+
+bool TinyLfuCache::get(std::string_view key, std::string *value) {
+    // Misses are counted too: a key's popularity is what decides admission.
+    sketch_.increment(StringKeyHash{}(key));
+    auto it = data_.find(key);
+    if (it == data_.end()) {
+        return false;
+    }
+    *value = it->value;
+    on_hit(&*it);
+    return true;
+}
+
+void TinyLfuCache::on_hit(const Entry *entry) {
+    switch (entry->segment) {
+        case Segment::kWindow:
+            window_.move_to_back(entry);
+            break;
+        case Segment::kProbation:
+            probation_.remove(entry);
+            entry->segment = Segment::kProtected;
+            protected_.push_back(entry);
+            if (protected_.size() > max_protected_size_) {
+                const Entry *demoted = protected_.front();
+                protected_.remove(demoted);
+                demoted->segment = Segment::kProbation;
+                probation_.push_back(demoted);
+            }
+            break;
+        case Segment::kProtected:
+            protected_.move_to_back(entry);
+            break;
+    }
+}
+
+void TinyLfuCache::evict() {
+    const Entry *candidate = window_.front();
+    window_.remove(candidate);
+    candidate->segment = Segment::kProbation;
+    probation_.push_back(candidate);
+    if (probation_.size() + protected_.size() <= max_main_size_) {
+        return;
+    }
+
+    const Entry *victim = probation_.front() != candidate ? probation_.front() : protected_.front();
+    if (victim == nullptr) {
+        erase(candidate);
+        return;
+    }
+    const auto candidate_frequency = sketch_.frequency(StringKeyHash{}(candidate->key));
+    const auto victim_frequency = sketch_.frequency(StringKeyHash{}(victim->key));
+    erase(candidate_frequency > victim_frequency ? victim : candidate);
+}
+
+void TinyLfuCache::erase(const Entry *entry) {
+    list_of(entry->segment).remove(entry);
+    data_.erase(data_.find(std::string_view(entry->key)));
+}
+
+RecencyList<TinyLfuCache::Entry> &TinyLfuCache::list_of(Segment segment) {
+    switch (segment) {
+        case Segment::kWindow:
+            return window_;
+        case Segment::kProbation:
+            return probation_;
+        case Segment::kProtected:
+            break;
+    }
+    return protected_;
+}
@@ -0,0 +1,68 @@
+#ifndef TINY_LFU_CACHE_H
+
+#define TINY_LFU_CACHE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "string_key.h"
+#include "frequency_sketch.h"
+#include "recency_list.h"
+
+// Scan-resistant alternative to LruCache with the same set()/get() contract
+// (W-TinyLFU). New keys enter a small window LRU (1% of max_size). Entries
+// leaving the window are candidates for the main segmented LRU and are
+// admitted only if the FrequencySketch has seen them more often than the
+// main victim. One-hit wonders from a scan therefore fail admission instead
+// of flushing frequently used entries. The main segment is split into a
+// probation part and a protected part (80%) that entries reach on a second hit.
+class TinyLfuCache {
+public:
+    explicit TinyLfuCache(size_t max_size);
+
+    TinyLfuCache(const TinyLfuCache &) = delete;
+    ~TinyLfuCache() = default;
+    TinyLfuCache(TinyLfuCache &&) = delete;
+    TinyLfuCache &operator=(const TinyLfuCache &) = delete;
+    TinyLfuCache &operator=(const TinyLfuCache &&) = delete;
+
+    void set(std::string_view key, std::string_view value);
+
+    bool get(std::string_view key, std::string *value);
+
+    [[nodiscard]] size_t size() const { return data_.size(); }
+
+private:
+    enum class Segment : uint8_t { kWindow, kProbation, kProtected };
+
+    struct Entry {
+        Entry(std::string_view key, std::string_view value) : key(key), value(value) {}
+
+        std::string key;
+        mutable std::string value;
+        mutable Segment segment{Segment::kWindow};
+        mutable const Entry *prev{nullptr};
+        mutable const Entry *next{nullptr};
+    };
+
+    // Records a hit on an entry and moves it within or between segments.
+    void on_hit(const Entry *entry);
+    // Moves the window's LRU entry into probation and, if the main segment is
+    // over capacity, evicts whichever of it and the main victim is less popular.
+    void evict();
+    void erase(const Entry *entry);
+
+    RecencyList<Entry> &list_of(Segment segment);
+
+    std::unordered_set<Entry, StringKeyHash, StringKeyEqual> data_;
+    RecencyList<Entry> window_;
+    RecencyList<Entry> probation_;
+    RecencyList<Entry> protected_;
+    FrequencySketch sketch_;
+    size_t max_window_size_;
+    size_t max_main_size_;
+    size_t max_protected_size_;
+};
+#endif
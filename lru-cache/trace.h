@@ -0,0 +1,97 @@
+#ifndef TRACE_H
+
+#define TRACE_H
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Key traces shared by lru_cache_bench and lru_cache_sim: readers for
+// recorded traces and generators for synthetic ones. Keys are strings, as
+// every engine takes them; generated key i is "key:<i>".
+
+// Draws ranks 0..n-1 with P(rank k) proportional to 1 / (k + 1)^skew.
+class ZipfGenerator {
+public:
+    ZipfGenerator(size_t n, double skew, uint64_t seed) : gen_(seed), cdf_(n) {
+        double sum = 0;
+        for (size_t k = 0; k < n; ++k) {
+            sum += 1.0 / std::pow(static_cast<double>(k + 1), skew);
+            cdf_[k] = sum;
+        }
+        for (auto &p : cdf_) {
+            p /= sum;
+        }
+    }
+
+    size_t operator()() {
+        const double u = std::uniform_real_distribution<double>(0, 1)(gen_);
+        const auto it = std::lower_bound(cdf_.begin(), cdf_.end(), u);
+        return std::min<size_t>(it - cdf_.begin(), cdf_.size() - 1);
+    }
+
+private:
+    std::mt19937_64 gen_;
+    std::vector<double> cdf_;
+};
+
+inline std::string TraceKey(uint64_t id) { return "key:" + std::to_string(id); }
+
+// One key per line; empty if the file cannot be read.
+inline std::vector<std::string> ReadTextTrace(const char *path) {
+    std::vector<std::string> trace;
+    std::ifstream in(path);
+    for (std::string key; std::getline(in, key);) {
+        trace.push_back(std::move(key));
+    }
+    return trace;
+}
+
+// Native-endian uint64 key ids back to back, the usual layout of recorded
+// block and object traces; empty if the file cannot be read. A trailing
+// partial id is ignored.
+inline std::vector<std::string> ReadBinaryTrace(const char *path) {
+    std::vector<std::string> trace;
+    std::ifstream in(path, std::ios::binary);
+    for (uint64_t id = 0; in.read(reinterpret_cast<char *>(&id), sizeof(id));) {
+        trace.push_back(TraceKey(id));
+    }
+    return trace;
+}
+
+inline std::vector<std::string> MakeZipfKeys(size_t accesses, size_t universe, double skew,
+                                             uint64_t seed) {
+    ZipfGenerator zipf(universe, skew, seed);
+    std::vector<std::string> trace;
+    trace.reserve(accesses);
+    for (size_t i = 0; i < accesses; ++i) {
+        trace.push_back(TraceKey(zipf()));
+    }
+    return trace;
+}
+
+inline std::vector<std::string> MakeUniformKeys(size_t accesses, size_t universe, uint64_t seed) {
+    std::mt19937_64 gen(seed);
+    std::vector<std::string> trace;
+    trace.reserve(accesses);
+    for (size_t i = 0; i < accesses; ++i) {
+        trace.push_back(TraceKey(gen() % universe));
+    }
+    return trace;
+}
+
+// Loops over the whole key space in order: every key is a miss for any cache
+// smaller than the universe under LRU.
+inline std::vector<std::string> MakeScanKeys(size_t accesses, size_t universe) {
+    std::vector<std::string> trace;
+    trace.reserve(accesses);
+    for (size_t i = 0; i < accesses; ++i) {
+        trace.push_back(TraceKey(i % universe));
+    }
+    return trace;
+}
+#endif
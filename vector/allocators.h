@@ -0,0 +1,192 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// Allocators to plug into Vector<T, Alloc> (or any standard container).
+
+// Bump allocator for memory that dies all at once, e.g. everything built
+// while serving one request. Allocate() carves from the current chunk and
+// takes a new chunk, twice as large as the last, when it runs out. Nothing
+// is freed on its own: Reset() drops every allocation in one go and keeps
+// the largest chunk, so a steady stream of similar requests stops touching
+// the heap after the first few.
+class MonotonicArena {
+   public:
+    explicit MonotonicArena(size_t initial_chunk_size = size_t{64} << 10) : next_chunk_size_(initial_chunk_size) {
+    }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    ~MonotonicArena() {
+        while (chunks_ != nullptr) {
+            FreeChunk(std::exchange(chunks_, chunks_->next));
+        }
+    }
+
+    void* Allocate(size_t bytes, size_t alignment) {
+        auto address = AlignUp(current_, alignment);
+        const auto end = reinterpret_cast<uintptr_t>(end_);
+        if (current_ == nullptr || address > end || bytes > end - address) {
+            AddChunk(bytes + alignment);
+            address = AlignUp(current_, alignment);
+        }
+        current_ = reinterpret_cast<std::byte*>(address + bytes);
+        return reinterpret_cast<void*>(address);
+    }
+
+    // Invalidates everything allocated so far.
+    void Reset() {
+        if (chunks_ == nullptr) {
+            return;
+        }
+        // The newest chunk is the largest one.
+        while (chunks_->next != nullptr) {
+            FreeChunk(std::exchange(chunks_->next, chunks_->next->next));
+        }
+        current_ = chunks_->Data();
+        end_ = current_ + chunks_->size;
+    }
+
+    // Bytes of chunk memory currently held.
+    [[nodiscard]] size_t Reserved() const {
+        size_t reserved = 0;
+        for (const Chunk* chunk = chunks_; chunk != nullptr; chunk = chunk->next) {
+            reserved += chunk->size;
+        }
+        return reserved;
+    }
+
+   private:
+    struct alignas(std::max_align_t) Chunk {
+        Chunk* next;
+        size_t size;
+
+        std::byte* Data() {
+            return reinterpret_cast<std::byte*>(this + 1);
+        }
+    };
+
+    static uintptr_t AlignUp(std::byte* ptr, size_t alignment) {
+        return (reinterpret_cast<uintptr_t>(ptr) + alignment - 1) & ~(alignment - 1);
+    }
+
+    void AddChunk(size_t min_size) {
+        const size_t size = std::max(next_chunk_size_, min_size);
+        auto* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + size));
+        chunk->next = chunks_;
+        chunk->size = size;
+        chunks_ = chunk;
+        current_ = chunk->Data();
+        end_ = current_ + size;
+        next_chunk_size_ = size * 2;
+    }
+
+    static void FreeChunk(Chunk* chunk) {
+        ::operator delete(chunk, sizeof(Chunk) + chunk->size);
+    }
+
+    Chunk* chunks_{nullptr};
+    std::byte* current_{nullptr};
+    std::byte* end_{nullptr};
+    size_t next_chunk_size_;
+};
+
+// Standard allocator over a MonotonicArena, which must outlive every
+// container using it. deallocate() does nothing; the memory comes back with
+// the arena's Reset(). Copies share the arena and compare equal.
+template <class T>
+class ArenaAllocator {
+   public:
+    using value_type = T;
+
+    explicit ArenaAllocator(MonotonicArena& arena) : arena_(&arena) {
+    }
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {  // NOLINT(google-explicit-constructor)
+    }
+
+    T* allocate(size_t count) {
+        if (count > SIZE_MAX / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* /*arr*/, size_t /*count*/) {
+    }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena_ == other.arena_;
+    }
+
+   private:
+    template <class U>
+    friend class ArenaAllocator;
+
+    MonotonicArena* arena_;
+};
+
+// Standard allocator for large buffers that backs every allocation with its
+// own mapping, aligned to and rounded up to 2 MiB, and asks for transparent
+// huge pages with madvise(MADV_HUGEPAGE). One TLB entry then covers 2 MiB
+// instead of 4 KiB, which cuts TLB misses on scans of gigabyte buffers.
+// Where huge pages are unavailable the buffer works with regular pages.
+// Each allocation costs at least 2 MiB, so this is no fit for small vectors.
+template <class T>
+class HugePageAllocator {
+   public:
+    using value_type = T;
+
+    static constexpr size_t kHugePageSize = size_t{2} << 20;
+
+    HugePageAllocator() = default;
+
+    template <class U>
+    HugePageAllocator(const HugePageAllocator<U>& /*other*/) {  // NOLINT(google-explicit-constructor)
+    }
+
+    T* allocate(size_t count) {
+        if (count > (SIZE_MAX - 2 * kHugePageSize) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        const size_t size = MappedSize(count);
+        // Map one huge page more than needed and trim both ends, so that the
+        // buffer starts on a huge page boundary.
+        auto* data = static_cast<std::byte*>(
+            ::mmap(nullptr, size + kHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        const auto address = reinterpret_cast<uintptr_t>(data);
+        const size_t head = (kHugePageSize - address % kHugePageSize) % kHugePageSize;
+        if (head != 0) {
+            ::munmap(data, head);
+        }
+        ::munmap(data + head + size, kHugePageSize - head);
+        ::madvise(data + head, size, MADV_HUGEPAGE);
+        return reinterpret_cast<T*>(data + head);
+    }
+
+    void deallocate(T* arr, size_t count) {
+        ::munmap(arr, MappedSize(count));
+    }
+
+    template <class U>
+    bool operator==(const HugePageAllocator<U>& /*other*/) const {
+        return true;
+    }
+
+   private:
+    static size_t MappedSize(size_t count) {
+        return (count * sizeof(T) + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    }
+};
@@ -0,0 +1,450 @@
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+
+#include "allocators.h"
+#include "small_vector.h"
+#include "vector.h"
+
+// Standalone benchmarks for the vector task.
+// Usage: vector_bench [name...]; without arguments every benchmark runs.
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+// Allocations of exactly g_payload_size bytes. Benchmarks pick element
+// payloads of a size no vector buffer can have, so this counts how many
+// times element contents were created or copied.
+std::atomic<size_t> g_payload_size{0};
+std::atomic<size_t> g_payload_allocations{0};
+
+}  // namespace
+
+// Counts every heap allocation made through operator new, so benchmarks can
+// report allocations per operation.
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == g_payload_size.load(std::memory_order_relaxed)) {
+        g_payload_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double MeasureSeconds(F &&f) {
+    const auto start = Clock::now();
+    f();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Keeps the compiler from dropping stores to memory reachable from `object`.
+template <typename T>
+void Escape(T &object) {
+    asm volatile("" : : "g"(&object) : "memory");
+}
+
+// Vector as it was before it kept raw storage: every slot of a new buffer is
+// value-initialized by new T[]() and then overwritten by std::copy.
+template <typename T>
+class LegacyVector {
+   public:
+    LegacyVector() : arr_(new T[0]) {}
+
+    LegacyVector(size_t capacity, size_t size)
+        : capacity_(capacity), size_(size), arr_(new T[capacity]()) {}
+
+    LegacyVector(const LegacyVector &) = delete;
+    LegacyVector &operator=(const LegacyVector &) = delete;
+    ~LegacyVector() { delete[] arr_; }
+
+    void Swap(LegacyVector &b) {
+        std::swap(arr_, b.arr_);
+        std::swap(size_, b.size_);
+        std::swap(capacity_, b.capacity_);
+    }
+
+    void PushBack(T a) {
+        if (size_ == capacity_) {
+            LegacyVector temp(capacity_ == 0 ? 1 : capacity_ * 2, size_);
+            std::copy(arr_, arr_ + size_, temp.arr_);
+            Swap(temp);
+        }
+        arr_[size_] = a;
+        size_++;
+    }
+
+    void Reserve(size_t a) {
+        if (a > capacity_) {
+            LegacyVector temp(a, size_);
+            std::copy(arr_, arr_ + size_, temp.arr_);
+            Swap(temp);
+        }
+    }
+
+    [[nodiscard]] size_t Size() const { return size_; }
+
+   private:
+    size_t capacity_{0};
+    size_t size_{0};
+    T *arr_;
+};
+
+template <typename V>
+double MeasureReserveMillis(size_t capacity) {
+    V v;
+    return MeasureSeconds([&] {
+               v.Reserve(capacity);
+               Escape(v);
+           }) *
+           1e3;
+}
+
+template <typename V, typename Make>
+double MeasureFillNanos(size_t count, Make &&make) {
+    V v;
+    const double seconds = MeasureSeconds([&] {
+        for (size_t i = 0; i < count; ++i) {
+            v.PushBack(make(i));
+        }
+        Escape(v);
+    });
+    if (v.Size() != count) {
+        std::printf("lost elements\n");
+    }
+    return seconds * 1e9 / static_cast<double>(count);
+}
+
+void BenchReserve() {
+    constexpr size_t kCapacity = size_t{1} << 26;
+    std::printf("%14s %14s %14s\n", "elements", "legacy ms", "raw ms");
+    std::printf("%14zu %14.2f %14.2f\n", kCapacity, MeasureReserveMillis<LegacyVector<int>>(kCapacity),
+                MeasureReserveMillis<Vector<int>>(kCapacity));
+}
+
+void BenchFill() {
+    constexpr size_t kCount = size_t{1} << 24;
+    constexpr size_t kStrings = size_t{1} << 21;
+    const auto make_int = [](size_t i) { return static_cast<int>(i); };
+    const auto make_string = [](size_t i) { return std::to_string(i); };
+    std::printf("%14s %14s %14s %14s\n", "element", "pushes", "legacy ns/op", "raw ns/op");
+    std::printf("%14s %14zu %14.2f %14.2f\n", "int", kCount,
+                MeasureFillNanos<LegacyVector<int>>(kCount, make_int),
+                MeasureFillNanos<Vector<int>>(kCount, make_int));
+    std::printf("%14s %14zu %14.2f %14.2f\n", "std::string", kStrings,
+                MeasureFillNanos<LegacyVector<std::string>>(kStrings, make_string),
+                MeasureFillNanos<Vector<std::string>>(kStrings, make_string));
+}
+
+struct CopyResult {
+    double copies_per_element;
+    double nanos_per_element;
+};
+
+// Pushes `count` freshly made elements as rvalues and counts the element
+// copies: payload allocations beyond the one each element starts with.
+template <typename V, typename Make>
+CopyResult MeasureCopies(size_t count, size_t payload_size, Make &&make) {
+    V v;
+    g_payload_allocations = 0;
+    g_payload_size = payload_size;
+    const double seconds = MeasureSeconds([&] {
+        for (size_t i = 0; i < count; ++i) {
+            v.PushBack(make(i));
+        }
+        Escape(v);
+    });
+    g_payload_size = 0;
+    const auto elements = static_cast<double>(count);
+    return {static_cast<double>(g_payload_allocations.load() - count) / elements,
+            seconds * 1e9 / elements};
+}
+
+void BenchCopies() {
+    constexpr size_t kCount = size_t{1} << 20;
+    // 40 characters do not fit the small string buffer: the string allocates
+    // 41 bytes, which is no multiple of sizeof(std::string).
+    constexpr size_t kLength = 40;
+    // 10 ints take 40 bytes, no multiple of sizeof(Vector<int>).
+    constexpr size_t kInts = 10;
+    const auto make_string = [](size_t i) {
+        std::string s(kLength, 'x');
+        s[i % kLength] = 'y';
+        return s;
+    };
+    const auto make_vector = [](size_t i) {
+        Vector<int> v(kInts);
+        v[0] = static_cast<int>(i);
+        return v;
+    };
+
+    std::printf("%14s %14s %14s %14s %14s\n", "element", "legacy copies", "legacy ns/op",
+                "moved copies", "moved ns/op");
+    const auto print = [](const char *element, CopyResult legacy, CopyResult moved) {
+        std::printf("%14s %14.2f %14.2f %14.2f %14.2f\n", element, legacy.copies_per_element,
+                    legacy.nanos_per_element, moved.copies_per_element, moved.nanos_per_element);
+    };
+    print("std::string",
+          MeasureCopies<LegacyVector<std::string>>(kCount, kLength + 1, make_string),
+          MeasureCopies<Vector<std::string>>(kCount, kLength + 1, make_string));
+    print("Vector<int>",
+          MeasureCopies<LegacyVector<Vector<int>>>(kCount, kInts * sizeof(int), make_vector),
+          MeasureCopies<Vector<Vector<int>>>(kCount, kInts * sizeof(int), make_vector));
+}
+
+// A float that is not trivially copyable, so Vector relocates it element by
+// element into operator new buffers, as it did for every type before the
+// trivially relocatable fast path.
+struct GenericFloat {
+    GenericFloat(float value) : value(value) {}  // NOLINT(google-explicit-constructor)
+    GenericFloat(const GenericFloat &other) noexcept : value(other.value) {}
+    GenericFloat &operator=(const GenericFloat &other) = default;
+
+    float value;
+};
+
+template <typename V>
+double MeasureRegrowMillis(size_t count) {
+    V v;
+    for (size_t i = 0; i < count; ++i) {
+        v.PushBack(static_cast<float>(i));
+    }
+    return MeasureSeconds([&] {
+               v.Reserve(2 * count);
+               Escape(v);
+           }) *
+           1e3;
+}
+
+void BenchRegrow() {
+    const auto make_float = [](size_t i) { return static_cast<float>(i); };
+    std::printf("%14s %14s %14s %14s\n", "floats", "", "generic", "relocatable");
+    for (size_t count : {size_t{1} << 18, size_t{1} << 22, size_t{1} << 26}) {
+        std::printf("%14zu %14s %14.2f %14.2f\n", count, "fill ns/op",
+                    MeasureFillNanos<Vector<GenericFloat>>(count, make_float),
+                    MeasureFillNanos<Vector<float>>(count, make_float));
+        std::printf("%14s %14s %14.3f %14.3f\n", "", "Reserve(2n) ms",
+                    MeasureRegrowMillis<Vector<GenericFloat>>(count),
+                    MeasureRegrowMillis<Vector<float>>(count));
+    }
+}
+
+// Work of one request: a few dozen short-lived vectors of various lengths,
+// built through `make(capacity)` and dropped together at the end.
+template <typename Make>
+int64_t ServeRequest(size_t request, Make &&make) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < 32; ++i) {
+        auto ints = make(0);
+        const size_t length = 1 + (request * 7 + i * 13) % 64;
+        for (size_t j = 0; j < length; ++j) {
+            ints.PushBack(static_cast<int>(i + j));
+        }
+        sum += ints[length / 2];
+    }
+    return sum;
+}
+
+struct RequestResult {
+    double nanos_per_request;
+    double allocations_per_request;
+};
+
+template <typename Serve>
+RequestResult MeasureRequests(size_t requests, Serve &&serve) {
+    const size_t allocations_before = g_allocations.load();
+    int64_t sum = 0;
+    const double seconds = MeasureSeconds([&] {
+        for (size_t request = 0; request < requests; ++request) {
+            sum += serve(request);
+        }
+        Escape(sum);
+    });
+    const auto count = static_cast<double>(requests);
+    return {seconds * 1e9 / count, static_cast<double>(g_allocations.load() - allocations_before) / count};
+}
+
+void BenchRequests() {
+    constexpr size_t kRequests = 200'000;
+    std::printf("%22s %14s %14s\n", "allocator", "ns/request", "allocs/request");
+    const auto print = [](const char *name, RequestResult result) {
+        std::printf("%22s %14.0f %14.2f\n", name, result.nanos_per_request, result.allocations_per_request);
+    };
+
+    print("std::allocator", MeasureRequests(kRequests, [](size_t request) {
+              return ServeRequest(request, [](size_t) { return Vector<int>(); });
+          }));
+
+    MonotonicArena arena;
+    print("ArenaAllocator", MeasureRequests(kRequests, [&](size_t request) {
+              const int64_t sum = ServeRequest(request, [&](size_t) {
+                  return Vector<int, ArenaAllocator<int>>(ArenaAllocator<int>(arena));
+              });
+              arena.Reset();
+              return sum;
+          }));
+
+    // The usual PMR setup: a monotonic resource per request over a reused
+    // buffer, with the heap as upstream once that runs out.
+    std::byte buffer[64 << 10];
+    print("pmr monotonic", MeasureRequests(kRequests, [&](size_t request) {
+              std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer));
+              return ServeRequest(request, [&](size_t) {
+                  return pmr::Vector<int>(std::pmr::polymorphic_allocator<int>(&resource));
+              });
+          }));
+}
+
+// Maps every buffer and opts it out of transparent huge pages, for a 4 KiB
+// page baseline however the system is configured.
+template <typename T>
+class SmallPageAllocator {
+   public:
+    using value_type = T;
+
+    T *allocate(size_t count) {
+        void *data = ::mmap(nullptr, count * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        ::madvise(data, count * sizeof(T), MADV_NOHUGEPAGE);
+        return static_cast<T *>(data);
+    }
+
+    void deallocate(T *arr, size_t count) { ::munmap(arr, count * sizeof(T)); }
+
+    bool operator==(const SmallPageAllocator & /*other*/) const { return true; }
+};
+
+struct ScanResult {
+    double sequential_nanos;
+    double page_stride_nanos;
+};
+
+// Nanoseconds per element read, once in order and once one element per
+// 4 KiB page: a fresh page every read, so with small pages nearly every read
+// misses the TLB.
+template <typename Alloc>
+ScanResult MeasureScans(size_t count) {
+    Vector<float, Alloc> v(count);
+    for (size_t i = 0; i < count; ++i) {
+        v[i] = static_cast<float>(i % 7);
+    }
+    ScanResult result{};
+    float sum = 0;
+    result.sequential_nanos = MeasureSeconds([&] {
+                                  for (size_t i = 0; i < count; ++i) {
+                                      sum += v[i];
+                                  }
+                                  Escape(sum);
+                              }) *
+                              1e9 / static_cast<double>(count);
+
+    constexpr size_t kStride = 4096 / sizeof(float);
+    const size_t pages = count / kStride;
+    // A few offsets within the page are enough: every pass is all misses.
+    constexpr size_t kPasses = 16;
+    result.page_stride_nanos = MeasureSeconds([&] {
+                                   for (size_t pass = 0; pass < kPasses; ++pass) {
+                                       const size_t offset = pass * 61 % kStride;
+                                       for (size_t page = 0; page < pages; ++page) {
+                                           sum += v[page * kStride + offset];
+                                       }
+                                   }
+                                   Escape(sum);
+                               }) *
+                               1e9 / static_cast<double>(pages * kPasses);
+    return result;
+}
+
+void BenchScan() {
+    constexpr size_t kFloats = size_t{1} << 27;
+    std::printf("%22s %14s %14s\n", "pages", "seq ns/read", "stride ns/read");
+    const auto print = [](const char *name, ScanResult result) {
+        std::printf("%22s %14.3f %14.2f\n", name, result.sequential_nanos, result.page_stride_nanos);
+    };
+    print("4 KiB", MeasureScans<SmallPageAllocator<float>>(kFloats));
+    print("HugePageAllocator", MeasureScans<HugePageAllocator<float>>(kFloats));
+}
+
+// A parsing hot loop: one vector of fields per record, most records with
+// fewer than 8 fields and a few with up to 24.
+template <typename V>
+RequestResult MeasureRecords(size_t records) {
+    return MeasureRequests(records, [](size_t record) {
+        const size_t fields = record % 16 == 0 ? 8 + record % 17 : 1 + record % 7;
+        V v;
+        for (size_t i = 0; i < fields; ++i) {
+            v.PushBack(static_cast<int>(record + i));
+        }
+        Escape(v);
+        return static_cast<int64_t>(v.Size());
+    });
+}
+
+void BenchSmall() {
+    constexpr size_t kRecords = 2'000'000;
+    std::printf("%22s %14s %14s\n", "vector", "ns/record", "allocs/record");
+    const auto print = [](const char *name, RequestResult result) {
+        std::printf("%22s %14.1f %14.2f\n", name, result.nanos_per_request, result.allocations_per_request);
+    };
+    print("LegacyVector<int>", MeasureRecords<LegacyVector<int>>(kRecords));
+    print("Vector<int>", MeasureRecords<Vector<int>>(kRecords));
+    print("SmallVector<int, 8>", MeasureRecords<SmallVector<int, 8>>(kRecords));
+}
+
+struct Benchmark {
+    std::string_view name;
+    void (*run)();
+};
+
+constexpr Benchmark kBenchmarks[] = {
+    {"reserve", BenchReserve},
+    {"fill", BenchFill},
+    {"copies", BenchCopies},
+    {"regrow", BenchRegrow},
+    {"requests", BenchRequests},
+    {"scan", BenchScan},
+    {"small", BenchSmall},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    for (const auto &benchmark : kBenchmarks) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || benchmark.name == argv[i];
+        }
+        if (selected) {
+            std::printf("== %s\n", benchmark.name.data());
+            benchmark.run();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "vector.h"
+
+// Vector with room for N elements inside the object: up to N elements it
+// never allocates, and past that it moves them into a Vector<T, Alloc> and
+// stays there, as a Vector keeps its capacity. The API and Iterator are
+// those of Vector. Moving an inline SmallVector moves its elements one by one.
+template <class T, size_t N, class Alloc = std::allocator<T>>
+class SmallVector {
+    static_assert(N > 0, "use Vector for no inline elements");
+
+   public:
+    using Iterator = typename Vector<T, Alloc>::Iterator;
+
+    [[nodiscard]] Iterator begin() const {
+        return Iterator(Data());
+    }
+
+    [[nodiscard]] Iterator end() const {
+        return Iterator(Data() + Size());
+    }
+
+    SmallVector() = default;
+
+    explicit SmallVector(const Alloc& alloc) : heap_(alloc) {
+    }
+
+    explicit SmallVector(size_t size, const Alloc& alloc = Alloc()) : heap_(alloc) {
+        Reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            EmplaceBack();
+        }
+    }
+
+    SmallVector(std::initializer_list<T> arr, const Alloc& alloc = Alloc()) : heap_(alloc) {
+        Reserve(arr.size());
+        for (const auto& value : arr) {
+            PushBack(value);
+        }
+    }
+
+    SmallVector(const SmallVector& a)
+        : heap_(std::allocator_traits<Alloc>::select_on_container_copy_construction(a.GetAllocator())) {
+        Reserve(a.Size());
+        for (const auto& value : a) {
+            PushBack(value);
+        }
+    }
+
+    SmallVector(SmallVector&& a) noexcept(std::is_nothrow_move_constructible_v<T>) : heap_(std::move(a.heap_)) {
+        for (; size_ < a.size_; ++size_) {
+            std::construct_at(Inline() + size_, std::move(a.Inline()[size_]));
+        }
+        a.Clear();
+    }
+
+    ~SmallVector() {
+        DestroyInline();
+    }
+
+    SmallVector& operator=(const SmallVector& a) {
+        if (this != &a) {
+            SmallVector temp(a);
+            *this = std::move(temp);
+        }
+        return *this;
+    }
+
+    // The heap buffer of `a` is taken over whole (see Vector's move
+    // assignment); inline elements are moved one by one.
+    SmallVector& operator=(SmallVector&& a) noexcept(std::is_nothrow_move_constructible_v<T> &&
+                                                     std::is_nothrow_move_assignable_v<Vector<T, Alloc>>) {
+        if (this == &a) {
+            return *this;
+        }
+        if (!a.IsInline()) {
+            DestroyInline();
+            heap_ = std::move(a.heap_);
+            return *this;
+        }
+        Clear();
+        for (size_t i = 0; i < a.size_; ++i) {
+            EmplaceBack(std::move(a.Inline()[i]));
+        }
+        a.Clear();
+        return *this;
+    }
+
+    void Swap(SmallVector& b) {
+        SmallVector temp(std::move(b));
+        b = std::move(*this);
+        *this = std::move(temp);
+    }
+
+    [[nodiscard]] Alloc GetAllocator() const {
+        return heap_.GetAllocator();
+    }
+
+    template <typename T1>
+    T& operator[](T1 i) const {
+        return Data()[i];
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return IsInline() ? size_ : heap_.Size();
+    }
+
+    [[nodiscard]] size_t Capacity() const {
+        return IsInline() ? N : heap_.Capacity();
+    }
+
+    // Whether the elements are stored inside the object.
+    [[nodiscard]] bool IsInline() const {
+        return heap_.Capacity() == 0;
+    }
+
+    void PushBack(const T& a) {
+        EmplaceBack(a);
+    }
+
+    void PushBack(T&& a) {
+        EmplaceBack(std::move(a));
+    }
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (!IsInline()) {
+            return heap_.EmplaceBack(std::forward<Args>(args)...);
+        }
+        if (size_ == N) {
+            // `args` may refer to an inline element, which spilling moves.
+            T value(std::forward<Args>(args)...);
+            Spill(2 * N);
+            return heap_.EmplaceBack(std::move(value));
+        }
+        std::construct_at(Inline() + size_, std::forward<Args>(args)...);
+        return Inline()[size_++];
+    }
+
+    void PopBack() {
+        if (!IsInline()) {
+            heap_.PopBack();
+        } else if (size_ != 0) {
+            size_--;
+            std::destroy_at(Inline() + size_);
+        }
+    }
+
+    void Clear() {
+        DestroyInline();
+        heap_.Clear();
+    }
+
+    void Reserve(size_t a) {
+        if (!IsInline()) {
+            heap_.Reserve(a);
+        } else if (a > N) {
+            Spill(a);
+        }
+    }
+
+   private:
+    // Inline elements are built with std::construct_at, not through Alloc.
+    T* Inline() const {
+        return std::launder(reinterpret_cast<T*>(const_cast<std::byte*>(storage_)));
+    }
+
+    T* Data() const {
+        return IsInline() ? Inline() : &heap_[0];
+    }
+
+    void DestroyInline() {
+        std::destroy_n(Inline(), size_);
+        size_ = 0;
+    }
+
+    // Moves the inline elements to a heap buffer of `capacity` slots. If
+    // that throws, the vector is left unchanged.
+    void Spill(size_t capacity) {
+        Vector<T, Alloc> heap(heap_.GetAllocator());
+        heap.Reserve(capacity);
+        for (size_t i = 0; i < size_; ++i) {
+            heap.PushBack(std::move_if_noexcept(Inline()[i]));
+        }
+        DestroyInline();
+        heap_ = std::move(heap);
+    }
+
+    alignas(T) std::byte storage_[N * sizeof(T)];
+    // Inline elements; unused once the elements moved to `heap_`.
+    size_t size_{0};
+    Vector<T, Alloc> heap_;
+};
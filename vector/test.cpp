@@ -1,14 +1,20 @@
 #include "vector.h"
 
+#include "allocators.h"
+#include "small_vector.h"
+
 #include <algorithm>
 #include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers.hpp>
 #include <catch2/matchers/catch_matchers_range_equals.hpp>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <memory_resource>
 #include <numeric>
 #include <ranges>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -354,6 +360,275 @@ TEST_CASE("Valid after move") {
     }
 }
 
+namespace {
+
+// Counts live instances; has no default constructor.
+struct Tracked {
+    explicit Tracked(int value) : value(value) {
+        ++alive;
+    }
+    Tracked(const Tracked& other) : value(other.value) {
+        ++alive;
+    }
+    Tracked& operator=(const Tracked&) = default;
+    ~Tracked() {
+        --alive;
+    }
+
+    int value;
+    static inline int alive = 0;
+};
+
+// Counts copies and moves; moving is noexcept unless `kNoexceptMove` is false.
+template <bool kNoexceptMove>
+struct Counted {
+    explicit Counted(int value) : value(value) {
+    }
+    Counted(const Counted& other) : value(other.value) {
+        ++copies;
+    }
+    Counted(Counted&& other) noexcept(kNoexceptMove) : value(other.value) {
+        ++moves;
+    }
+    Counted& operator=(const Counted&) = default;
+
+    int value;
+    static inline int copies = 0;
+    static inline int moves = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Elements live only between add and remove") {
+    {
+        Vector<Tracked> a;
+        a.Reserve(100);
+        REQUIRE(Tracked::alive == 0);
+        for (auto i : std::views::iota(0, 10)) {
+            a.PushBack(Tracked(i));
+        }
+        REQUIRE(Tracked::alive == 10);
+        a.Reserve(1000);
+        REQUIRE(Tracked::alive == 10);
+        for (auto i : std::views::iota(0, 10)) {
+            REQUIRE(a[i].value == i);
+        }
+
+        a.PopBack();
+        REQUIRE(Tracked::alive == 9);
+        auto b = a;
+        REQUIRE(Tracked::alive == 18);
+        a.Clear();
+        REQUIRE(Tracked::alive == 9);
+        REQUIRE(a.Capacity() == 1000);
+        a = b;
+        REQUIRE(Tracked::alive == 18);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("EmplaceBack and moving growth") {  // NOLINT(readability-function-cognitive-complexity)
+    using Movable = Counted<true>;
+    {
+        Vector<Movable> a;
+        for (auto i : std::views::iota(0, 100)) {
+            REQUIRE(a.EmplaceBack(i).value == i);
+        }
+        Movable last(100);
+        a.PushBack(std::move(last));
+        REQUIRE(Movable::copies == 0);
+        a.PushBack(last);
+        REQUIRE(Movable::copies == 1);
+        a.Reserve(1000);
+        REQUIRE(Movable::copies == 1);
+        for (auto i : std::views::iota(0, 101)) {
+            REQUIRE(a[i].value == i);
+        }
+    }
+
+    // Moves that may throw would lose elements midway, so growth copies.
+    using Copied = Counted<false>;
+    Vector<Copied> b;
+    for (auto i : std::views::iota(0, 100)) {
+        b.EmplaceBack(i);
+    }
+    REQUIRE(Copied::copies > 100);
+    REQUIRE(Copied::moves == 0);
+
+    Vector<Vector<int>> c;
+    for (auto i : std::views::iota(0, 100)) {
+        c.EmplaceBack(Vector<int>{i, i + 1});
+    }
+    REQUIRE(c[99][1] == 100);
+
+    // The argument may be an element that growth is about to move away.
+    Vector<Vector<int>> d;
+    d.PushBack(Vector<int>{1, 2, 3});
+    REQUIRE(d.Capacity() == 1);
+    d.PushBack(d[0]);
+    d.EmplaceBack(d[1]);
+    REQUIRE(d.Size() == 3);
+    for (auto i : std::views::iota(0, 3)) {
+        Check(d[i], {1, 2, 3});
+    }
+}
+
+TEST_CASE("Large trivially copyable buffers") {  // NOLINT(readability-function-cognitive-complexity)
+    // Past a megabyte the buffer is mapped and grows by remapping.
+    constexpr int kSize = 1 << 20;
+    Vector<int> a;
+    for (auto i : std::views::iota(0, kSize)) {
+        a.PushBack(i);
+    }
+    REQUIRE(a.Capacity() == kSize);
+    a.PushBack(a[0]);
+    REQUIRE(a.Capacity() == 2 * kSize);
+    a.Reserve(8 * kSize);
+    REQUIRE(a.Capacity() == 8 * kSize);
+    REQUIRE(a.Size() == kSize + 1);
+    auto ints = std::views::iota(0, kSize);
+    REQUIRE(std::equal(ints.begin(), ints.end(), a.begin()));
+    REQUIRE(a[kSize] == 0);
+
+    auto b = a;
+    b.PopBack();
+    REQUIRE(std::ranges::equal(b, std::views::iota(0, kSize)));
+    Vector<int> c = std::move(a);
+    REQUIRE(c.Size() == kSize + 1);
+    c = b;
+    REQUIRE(c.Size() == kSize);
+
+    Vector<std::array<double, 3>> d(kSize, 0);
+    for (auto i : std::views::iota(0, kSize)) {
+        d.PushBack({1.0 * i, 2.0 * i, 3.0 * i});
+    }
+    d.PushBack({});
+    REQUIRE(d[kSize - 1][2] == 3.0 * (kSize - 1));
+    REQUIRE(d[kSize][0] == 0.0);
+}
+
+TEST_CASE("Arena allocator") {  // NOLINT(readability-function-cognitive-complexity)
+    using ArenaVector = Vector<int, ArenaAllocator<int>>;
+    MonotonicArena arena(1024);
+    ArenaVector a{ArenaAllocator<int>(arena)};
+    for (auto i : std::views::iota(0, 1000)) {
+        a.PushBack(i);
+    }
+    REQUIRE(std::ranges::equal(a, std::views::iota(0, 1000)));
+
+    // Copies keep the allocator of the copied vector.
+    auto b = a;
+    REQUIRE(b.GetAllocator() == a.GetAllocator());
+    REQUIRE(std::ranges::equal(b, a));
+
+    // Assignment leaves the allocator in place and moves between arenas
+    // element by element.
+    MonotonicArena other_arena;
+    ArenaVector c({1, 2, 3}, ArenaAllocator<int>(other_arena));
+    c = a;
+    REQUIRE(c.GetAllocator() == ArenaAllocator<int>(other_arena));
+    REQUIRE(std::ranges::equal(c, a));
+    ArenaVector d{ArenaAllocator<int>(other_arena)};
+    d = std::move(b);
+    REQUIRE(d.GetAllocator() == ArenaAllocator<int>(other_arena));
+    REQUIRE(std::ranges::equal(d, a));
+    ArenaVector e{ArenaAllocator<int>(other_arena)};
+    e = std::move(d);
+    REQUIRE(d.Size() == 0);
+    REQUIRE(std::ranges::equal(e, a));
+
+    const size_t reserved = arena.Reserved();
+    REQUIRE(reserved >= 1000 * sizeof(int));
+    arena.Reset();
+    REQUIRE(arena.Reserved() <= reserved);
+    ArenaVector f{ArenaAllocator<int>(arena)};
+    f.Reserve(10);
+    f.PushBack(7);
+    REQUIRE(f[0] == 7);
+}
+
+TEST_CASE("Polymorphic allocator") {
+    std::pmr::monotonic_buffer_resource resource;
+    pmr::Vector<std::pmr::string> a{std::pmr::polymorphic_allocator<std::pmr::string>(&resource)};
+    for (auto i : std::views::iota(0, 100)) {
+        a.EmplaceBack(std::to_string(i) + " is a string too long for the small buffer");
+    }
+    REQUIRE(a[42] == "42 is a string too long for the small buffer");
+    // Elements are built through the allocator and take its resource.
+    REQUIRE(a[42].get_allocator().resource() == &resource);
+
+    pmr::Vector<int> b(3);
+    REQUIRE(b.GetAllocator().resource() == std::pmr::get_default_resource());
+}
+
+TEST_CASE("Huge page allocator") {
+    Vector<double, HugePageAllocator<double>> a;
+    for (auto i : std::views::iota(0, 1 << 20)) {
+        a.PushBack(i);
+    }
+    REQUIRE(reinterpret_cast<uintptr_t>(&a[0]) % HugePageAllocator<double>::kHugePageSize == 0);
+    REQUIRE(a[12345] == 12345.0);
+    auto b = a;
+    b.Clear();
+    b.Reserve(10);
+    REQUIRE(b.Capacity() == 1 << 20);
+    REQUIRE(std::accumulate(a.begin(), a.end(), 0.0) == 1048576.0 * 1048575.0 / 2);
+}
+
+TEST_CASE("Small vector") {  // NOLINT(readability-function-cognitive-complexity)
+    {
+        SmallVector<Tracked, 4> a;
+        REQUIRE(a.Capacity() == 4);
+        for (auto i : std::views::iota(0, 4)) {
+            a.EmplaceBack(i);
+        }
+        REQUIRE(a.IsInline());
+        const auto* object = reinterpret_cast<const std::byte*>(&a);
+        const auto* first = reinterpret_cast<const std::byte*>(&a[0]);
+        REQUIRE((first >= object && first < object + sizeof(a)));
+
+        auto b = a;
+        REQUIRE(b.IsInline());
+        REQUIRE(Tracked::alive == 8);
+
+        // The argument is an inline element that spilling moves away.
+        a.PushBack(a[1]);
+        REQUIRE_FALSE(a.IsInline());
+        REQUIRE(a.Capacity() == 8);
+        REQUIRE(a[4].value == 1);
+        REQUIRE(Tracked::alive == 9);
+
+        a.Swap(b);
+        REQUIRE(a.Size() == 4);
+        REQUIRE(b.Size() == 5);
+        REQUIRE(b[4].value == 1);
+
+        auto c = std::move(b);
+        REQUIRE(c.Size() == 5);
+        REQUIRE(b.Size() == 0);
+        c = a;
+        REQUIRE(c.Size() == 4);
+        c.PopBack();
+        c.Clear();
+        REQUIRE(c.Size() == 0);
+        REQUIRE(Tracked::alive == 4);
+    }
+    REQUIRE(Tracked::alive == 0);
+
+    SmallVector<int, 8> d = {5, 3, 1, 4, 2};
+    std::ranges::sort(d);
+    REQUIRE(std::ranges::equal(d, std::views::iota(1, 6)));
+    SmallVector<int, 8>::Iterator it = d.begin();
+    REQUIRE(it[4] == 5);
+    SmallVector<int, 8> e(100);
+    REQUIRE_FALSE(e.IsInline());
+    REQUIRE(std::ranges::all_of(e, [](int x) { return x == 0; }));
+    e.Reserve(1000);
+    e = std::move(d);
+    REQUIRE(e.Size() == 5);
+    REQUIRE(e[2] == 3);
+}
+
 TEST_CASE("Move speed") {
     Vector<int> v1;
     Vector<int> v2;
@@ -1,12 +1,21 @@
 #pragma once
 
+#include <sys/mman.h>
+
 #include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
 #include <utility>
 
-template<class T>
+// Elements come from Alloc, a standard allocator (std::allocator_traits is
+// used throughout); pmr::Vector below takes a std::pmr::memory_resource.
+template<class T, class Alloc = std::allocator<T>>
 class Vector {
    public:
     class Iterator {
@@ -133,69 +142,124 @@ class Vector {
         return Iterator(it);
     }
 
-    Vector() : arr_(new T[0]) {
+    Vector() = default;
+
+    explicit Vector(const Alloc& alloc) : alloc_(alloc) {
+    }
+
+    explicit Vector(size_t size, const Alloc& alloc = Alloc()) : Vector(size, size, alloc) {
+    }
+
+    // Room for `capacity` elements, the first `size` of them value-initialized.
+    explicit Vector(size_t capacity, size_t size, const Alloc& alloc = Alloc())
+        : alloc_(alloc), capacity_(capacity), arr_(Allocate(capacity)) {
+        try {
+            for (; size_ < size; ++size_) {
+                Construct(arr_ + size_);
+            }
+        } catch (...) {
+            Release();
+            throw;
+        }
     }
 
-    explicit Vector(size_t size) : capacity_(size), size_(size), arr_(new T[size]()) {
+    Vector(std::initializer_list<T> arr, const Alloc& alloc = Alloc())
+        : alloc_(alloc), capacity_(arr.size()), arr_(Allocate(arr.size())) {
+        try {
+            for (const auto& value : arr) {
+                Construct(arr_ + size_, value);
+                ++size_;
+            }
+        } catch (...) {
+            Release();
+            throw;
+        }
     }
 
-    explicit Vector(size_t capacity, size_t size)
-        : capacity_(capacity), size_(size), arr_(new T[capacity]()) {
+    Vector(const Vector& a) : Vector(a, AllocTraits::select_on_container_copy_construction(a.alloc_)) {
     }
 
-    Vector(std::initializer_list<T> arr)
-        : capacity_(arr.size()), size_(arr.size()), arr_(new T[arr.size()]()) {
-        std::copy(arr.begin(), arr.end(), arr_);
+    Vector(const Vector& a, const Alloc& alloc) : alloc_(alloc), capacity_(a.capacity_), arr_(Allocate(a.capacity_)) {
+        try {
+            for (; size_ < a.size_; ++size_) {
+                Construct(arr_ + size_, a.arr_[size_]);
+            }
+        } catch (...) {
+            Release();
+            throw;
+        }
     }
 
-    Vector(Vector& a) : capacity_(a.capacity_), size_(a.size_), arr_(new T[capacity_]) {
-        std::copy(a.begin(), a.end(), arr_);
+    Vector(Vector&& a) noexcept : alloc_(std::move(a.alloc_)) {
+        Steal(a);
     }
 
-    Vector(Vector&& a) noexcept : capacity_(a.capacity_), size_(a.size_), arr_(a.arr_) {
-        a.arr_ = nullptr;
-        a.size_ = 0;
-        a.capacity_ = 0;
+    // Takes over the buffer of `a` if `alloc` can free it, and otherwise
+    // moves its elements one by one into a buffer from `alloc`.
+    Vector(Vector&& a, const Alloc& alloc) : alloc_(alloc) {
+        if (alloc_ == a.alloc_) {
+            Steal(a);
+            return;
+        }
+        arr_ = Allocate(a.capacity_);
+        capacity_ = a.capacity_;
+        try {
+            for (; size_ < a.size_; ++size_) {
+                Construct(arr_ + size_, std::move(a.arr_[size_]));
+            }
+        } catch (...) {
+            Release();
+            throw;
+        }
     }
 
     ~Vector() {
-        delete[] arr_;
+        Release();
     }
 
+    // The allocator is only replaced by that of `a` if the allocator type
+    // asks for it (propagate_on_container_copy_assignment), as in std::vector.
     Vector& operator=(const Vector& a) {
         if (this == &a) {
             return *this;
         }
-        delete[] arr_;
-        capacity_ = a.capacity_;
-        size_ = a.size_;
-        arr_ = new T[capacity_];  // NOLINT(cppcoreguidelines-owning-memory)
-        std::copy(a.begin(), a.end(), arr_);
+        constexpr bool kPropagate = AllocTraits::propagate_on_container_copy_assignment::value;
+        Vector temp(a, kPropagate ? a.alloc_ : alloc_);
+        if constexpr (kPropagate) {
+            std::swap(alloc_, temp.alloc_);
+        }
+        SwapBuffers(temp);
         return *this;
     }
 
-    Vector& operator=(Vector&& a) noexcept {
+    Vector& operator=(Vector&& a) noexcept(kMoveAssignSteals) {
         if (this == &a) {
             return *this;
         }
-
-        delete[] arr_;
-
-        arr_ = a.arr_;
-        size_ = a.size_;
-        capacity_ = a.capacity_;
-
-        a.arr_ = nullptr;
-        a.size_ = 0;
-        a.capacity_ = 0;
-
+        if constexpr (kMoveAssignSteals) {
+            Release();
+            if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+                alloc_ = std::move(a.alloc_);
+            }
+            Steal(a);
+        } else {
+            // An allocator that stays behind cannot free the buffer of `a`
+            // unless the two compare equal.
+            Vector temp(std::move(a), alloc_);
+            SwapBuffers(temp);
+        }
         return *this;
     }
 
     void Swap(Vector& b) {
-        std::swap(arr_, b.arr_);
-        std::swap(size_, b.size_);
-        std::swap(capacity_, b.capacity_);
+        if constexpr (AllocTraits::propagate_on_container_swap::value) {
+            std::swap(alloc_, b.alloc_);
+        }
+        SwapBuffers(b);
+    }
+
+    [[nodiscard]] Alloc GetAllocator() const {
+        return alloc_;
     }
 
     template <typename T1>
@@ -220,38 +284,224 @@ class Vector {
         return capacity_;
     }
 
-    void PushBack(T a) {
-        if (size_ == capacity_) {
-            Vector temp = Vector(capacity_ == 0 ? 1 : capacity_ * 2LL, size_);
-            std::copy(begin(), end(), temp.arr_);
-            this->Swap(temp);
-        }
+    void PushBack(const T& a) {
+        EmplaceBack(a);
+    }
 
-        *end() = a;
-        size_++;
+    void PushBack(T&& a) {
+        EmplaceBack(std::move(a));
+    }
 
+    // Constructs the new element in place from `args`. They may refer to an
+    // element of this vector: on growth the new element is built before the
+    // old ones are relocated.
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (size_ == capacity_) {
+            if constexpr (kTriviallyRelocatable) {
+                if (IsMapped(capacity_)) {
+                    // Remapping may move the buffer that `args` point into.
+                    T value(std::forward<Args>(args)...);
+                    Remap(capacity_ * 2);
+                    Construct(arr_ + size_, value);
+                    return arr_[size_++];
+                }
+            }
+            const size_t capacity = capacity_ == 0 ? 1 : capacity_ * 2;
+            T* arr = Allocate(capacity);
+            try {
+                Construct(arr + size_, std::forward<Args>(args)...);
+            } catch (...) {
+                Deallocate(arr, capacity);
+                throw;
+            }
+            try {
+                Relocate(arr);
+            } catch (...) {
+                AllocTraits::destroy(alloc_, arr + size_);
+                Deallocate(arr, capacity);
+                throw;
+            }
+            Replace(arr, capacity);
+        } else {
+            Construct(arr_ + size_, std::forward<Args>(args)...);
+        }
+        return arr_[size_++];
     }
 
     void PopBack() {
         if (size_ != 0) {
             size_--;
+            AllocTraits::destroy(alloc_, arr_ + size_);
         }
     }
 
     void Clear() {
+        Destroy(arr_, size_);
         size_ = 0;
     }
 
     void Reserve(size_t a) {
         if (a > capacity_) {
-            Vector temp(a, size_);
-            std::copy(begin(), end(), temp.arr_);
-            Swap(temp);
+            Reallocate(a);
         }
     }
 
    private:
+    using AllocTraits = std::allocator_traits<Alloc>;
+
+    static_assert(std::is_same_v<typename AllocTraits::value_type, T>, "Alloc must allocate T");
+    static_assert(std::is_same_v<typename AllocTraits::pointer, T*>, "fancy pointers are not supported");
+
+    static constexpr bool kMoveAssignSteals =
+        AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value;
+
+    // Trivially copyable elements can be moved to another address bit by bit,
+    // by memcpy or by remapping the pages that hold them.
+    static constexpr bool kTriviallyRelocatable = std::is_trivially_copyable_v<T>;
+
+    // With the default allocator, buffers of trivially relocatable elements
+    // from this size on are mapped directly rather than taken from operator
+    // new, so that growth can let the kernel extend them in place or move
+    // their pages instead of copying. Other allocators get every buffer from
+    // their allocate().
+    static constexpr size_t kMapThreshold = size_t{1} << 20;
+
+    static constexpr bool IsMapped(size_t capacity) {
+        return kTriviallyRelocatable && std::is_same_v<Alloc, std::allocator<T>> && alignof(T) <= 4096 &&
+               capacity * sizeof(T) >= kMapThreshold;
+    }
+
+    // Raw storage: elements are only constructed when they are added, so
+    // growing never default-constructs slots that are about to be overwritten
+    // and T needs no default constructor.
+    T* Allocate(size_t capacity) {
+        if (capacity == 0) {
+            return nullptr;
+        }
+        if (IsMapped(capacity)) {
+            void* arr = ::mmap(nullptr, capacity * sizeof(T), PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (arr == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(arr);
+        }
+        return AllocTraits::allocate(alloc_, capacity);
+    }
+
+    void Deallocate(T* arr, size_t capacity) {
+        if (arr == nullptr) {
+            return;
+        }
+        if (IsMapped(capacity)) {
+            ::munmap(arr, capacity * sizeof(T));
+            return;
+        }
+        AllocTraits::deallocate(alloc_, arr, capacity);
+    }
+
+    // Elements are built and destroyed through the allocator, so that e.g.
+    // a polymorphic_allocator hands its memory resource on to them.
+    template <typename... Args>
+    void Construct(T* slot, Args&&... args) {
+        AllocTraits::construct(alloc_, slot, std::forward<Args>(args)...);
+    }
+
+    void Destroy(T* arr, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            AllocTraits::destroy(alloc_, arr + i);
+        }
+    }
+
+    void Release() {
+        Destroy(arr_, size_);
+        Deallocate(arr_, capacity_);
+    }
+
+    // Takes the buffer of `a`, leaving it empty. Ours must be released.
+    void Steal(Vector& a) {
+        arr_ = std::exchange(a.arr_, nullptr);
+        size_ = std::exchange(a.size_, 0);
+        capacity_ = std::exchange(a.capacity_, 0);
+    }
+
+    void SwapBuffers(Vector& b) {
+        std::swap(arr_, b.arr_);
+        std::swap(size_, b.size_);
+        std::swap(capacity_, b.capacity_);
+    }
+
+    // Moves the elements to a new buffer of `capacity` slots. If that throws,
+    // the vector is left unchanged.
+    void Reallocate(size_t capacity) {
+        if (IsMapped(capacity_)) {
+            Remap(capacity);
+            return;
+        }
+        T* arr = Allocate(capacity);
+        try {
+            Relocate(arr);
+        } catch (...) {
+            Deallocate(arr, capacity);
+            throw;
+        }
+        Replace(arr, capacity);
+    }
+
+    // Constructs the elements in uninitialized `arr`, moving them unless
+    // moving may throw and copying is possible (std::move_if_noexcept), so
+    // that a throwing element leaves the originals intact. On an exception,
+    // whatever was constructed in `arr` is destroyed again.
+    void Relocate(T* arr) {
+        if constexpr (kTriviallyRelocatable) {
+            if (size_ != 0) {
+                std::memcpy(arr, arr_, size_ * sizeof(T));
+            }
+            return;
+        }
+        size_t i = 0;
+        try {
+            for (; i < size_; ++i) {
+                Construct(arr + i, std::move_if_noexcept(arr_[i]));
+            }
+        } catch (...) {
+            Destroy(arr, i);
+            throw;
+        }
+    }
+
+    // Grows a mapped buffer to `capacity` slots, which must be more than it
+    // has. The kernel extends the mapping in place when the address range
+    // after it is free, and otherwise moves its pages rather than their
+    // contents, so even gigabyte buffers grow in microseconds.
+    void Remap(size_t capacity) {
+        void* arr = ::mremap(arr_, capacity_ * sizeof(T), capacity * sizeof(T), MREMAP_MAYMOVE);
+        if (arr == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        arr_ = static_cast<T*>(arr);
+        capacity_ = capacity;
+    }
+
+    // Drops the current buffer, whose elements were relocated to `arr`.
+    void Replace(T* arr, size_t capacity) {
+        Destroy(arr_, size_);
+        Deallocate(arr_, capacity_);
+        arr_ = arr;
+        capacity_ = capacity;
+    }
+
+    [[no_unique_address]] Alloc alloc_{};
     size_t capacity_{0};
     size_t size_{0};
     T* arr_{};
 };
+
+namespace pmr {
+
+// Vector whose buffers and elements come from a std::pmr::memory_resource.
+template <class T>
+using Vector = ::Vector<T, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr